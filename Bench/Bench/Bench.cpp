@@ -0,0 +1,351 @@
+// Bench.cpp : standalone micro benchmarks for the messaging building blocks.
+// Build in Release; Debug numbers are not representative.
+//
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <latch>
+#include <thread>
+#include "LzCompressor.h"
+#include "MessageSchema.h"
+#include "BitStreamConversion.h"
+#include "ZeroMQ.h"
+#include "Proxy.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// Enough repetitions that every measurement covers ~64 MB of input.
+	constexpr size_t kBytesPerMeasurement = size_t{ 64 } << 20;
+
+	// MB here is 2^20 bytes.
+	double nsPerMB(Clock::duration elapsed, size_t bytes)
+	{
+		double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		return ns / (static_cast<double>(bytes) / (1024.0 * 1024.0));
+	}
+
+	// Low entropy: a short record repeated, like a burst of near-identical status messages.
+	std::vector<uint8_t> repetitivePayload(size_t size)
+	{
+		static const char record[] = "appId=2;appStatus=1;health=OK;";
+		std::vector<uint8_t> out(size);
+		for (size_t i = 0; i < size; ++i)
+			out[i] = static_cast<uint8_t>(record[i % (sizeof(record) - 1)]);
+		return out;
+	}
+
+	// Medium entropy: packed little-endian structs whose counters drift, like a
+	// buffer of AppDataRequest payloads.
+	std::vector<uint8_t> structuredPayload(size_t size)
+	{
+		std::mt19937 rng(7);
+		std::vector<uint8_t> out(size);
+		uint32_t counter = 0;
+		for (size_t i = 0; i + 16 <= size; i += 16) {
+			uint32_t fields[4] = { 2, counter++, static_cast<uint32_t>(rng() & 0xFF), 0 };
+			std::memcpy(out.data() + i, fields, sizeof(fields));
+		}
+		return out;
+	}
+
+	// High entropy: uniformly random bytes, the incompressible worst case.
+	std::vector<uint8_t> randomPayload(size_t size)
+	{
+		std::mt19937 rng(11);
+		std::vector<uint8_t> out(size);
+		for (auto& b : out)
+			b = static_cast<uint8_t>(rng());
+		return out;
+	}
+
+	void benchCompression(const char* kind, const std::vector<uint8_t>& input)
+	{
+		const size_t size = input.size();
+		std::vector<uint8_t> compressed(LzCompressor::maxCompressedSize(size));
+		std::vector<uint8_t> restored(size);
+		const size_t reps = kBytesPerMeasurement / size + 1;
+
+		size_t packed = 0;
+		auto start = Clock::now();
+		for (size_t i = 0; i < reps; ++i)
+			packed = LzCompressor::compress(input.data(), size, compressed.data(), compressed.size());
+		auto compressTime = Clock::now() - start;
+
+		bool ok = true;
+		start = Clock::now();
+		for (size_t i = 0; i < reps; ++i)
+			ok &= LzCompressor::decompress(compressed.data(), packed, restored.data(), size);
+		auto decompressTime = Clock::now() - start;
+		ok &= restored == input;
+
+		std::cout << std::left << std::setw(12) << kind
+			<< std::right << std::setw(9) << size
+			<< std::setw(10) << std::fixed << std::setprecision(3) << static_cast<double>(packed) / size
+			<< std::setw(16) << std::setprecision(0) << nsPerMB(compressTime, reps * size)
+			<< std::setw(16) << nsPerMB(decompressTime, reps * size)
+			<< (ok ? "" : "  ROUNDTRIP FAILED") << std::endl;
+	}
+
+	// Packs 4096 12-bit samples (e.g. quantized sensor readings) value by value and
+	// through the bulk array calls, and checks that both produce the same bytes.
+	void benchBitPacking()
+	{
+		constexpr unsigned kBits = 12;
+		constexpr size_t kCount = 4096;
+		constexpr size_t reps = 2000;
+		std::mt19937 rng(3);
+		std::vector<uint16_t> samples(kCount);
+		for (auto& v : samples)
+			v = static_cast<uint16_t>(rng() & 0xFFF);
+
+		std::vector<uint8_t> single;
+		std::vector<uint8_t> bulk;
+		auto start = Clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			single.clear();
+			BitWriter writer(single);
+			for (uint16_t v : samples)
+				writer.Write(v, kBits);
+		}
+		auto writeTime = Clock::now() - start;
+
+		start = Clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			bulk.clear();
+			BitWriter writer(bulk);
+			writer.WriteArray(samples.data(), samples.size(), kBits);
+		}
+		auto writeArrayTime = Clock::now() - start;
+
+		std::vector<uint16_t> decoded(kCount);
+		start = Clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			BitReader reader(bulk);
+			for (auto& v : decoded)
+				v = static_cast<uint16_t>(reader.Read(kBits));
+		}
+		auto readTime = Clock::now() - start;
+
+		start = Clock::now();
+		for (size_t r = 0; r < reps; ++r) {
+			BitReader reader(bulk);
+			reader.ReadArray(decoded.data(), decoded.size(), kBits);
+		}
+		auto readArrayTime = Clock::now() - start;
+
+		auto perValue = [&](Clock::duration elapsed) {
+			return std::chrono::duration<double, std::nano>(elapsed).count() / (reps * kCount);
+		};
+		const bool ok = single == bulk && decoded == samples;
+		std::cout << kCount << " x " << kBits << " bits -> " << bulk.size() << " bytes (raw uint16_t: "
+			<< kCount * sizeof(uint16_t) << ")" << (ok ? "" : "  ROUNDTRIP FAILED") << std::endl;
+		std::cout << std::fixed << std::setprecision(2)
+			<< "Write " << perValue(writeTime) << " ns/value, WriteArray " << perValue(writeArrayTime)
+			<< " ns/value, Read " << perValue(readTime) << " ns/value, ReadArray " << perValue(readArrayTime)
+			<< " ns/value" << std::endl;
+	}
+
+	// Brings up the sockets of the three Dummy services at the same moment, each on
+	// its own thread, through the in-process proxy. Reports how long until the last
+	// publisher's init() returned and whether every publisher then saw both other
+	// services subscribed to its requests. subscriberFirst is App::Initialize's
+	// order; the other order is how the services used to start.
+	void benchStartup(const ProxyEndpoints& proxy, bool subscriberFirst)
+	{
+		const char* kinds[] = { "statusRequestFrom", "additionRequestFrom", "multiplicationRequestFrom" };
+		std::latch go(3);
+		std::latch done(3);
+		std::atomic<int> ready{ 0 };
+		Clock::time_point finished[3];
+		const auto start = Clock::now();
+
+		auto service = [&](int n) {
+			std::vector<std::string> requests;
+			std::vector<std::string> subscriptions;
+			for (const char* kind : kinds) {
+				requests.push_back(kind + std::to_string(n));
+				for (int other = 1; other <= 3; ++other) {
+					if (other != n)
+						subscriptions.push_back(kind + std::to_string(other));
+				}
+			}
+			ZeroMQSubscriber subscriber(proxy.backend, subscriptions);
+			ZeroMQPublisher publisher(proxy.frontend);
+			publisher.setReadiness(requests, ZeroMQPublisher::kDefaultReadyTimeout, 2);
+
+			go.arrive_and_wait();
+			if (subscriberFirst) {
+				subscriber.init();
+				publisher.init();
+			}
+			else {
+				publisher.init();
+				subscriber.init();
+			}
+			finished[n - 1] = Clock::now();
+			if (publisher.waitForSubscribers(requests, std::chrono::milliseconds(0), 2))
+				++ready;
+			// keep the subscriptions up until every service has checked
+			done.arrive_and_wait();
+		};
+		std::thread services[] = { std::thread(service, 1), std::thread(service, 2), std::thread(service, 3) };
+		for (std::thread& t : services)
+			t.join();
+
+		Clock::time_point last = finished[0];
+		for (const auto& t : finished)
+			last = t > last ? t : last;
+		std::cout << std::left << std::setw(18) << (subscriberFirst ? "subscriber first" : "publisher first")
+			<< std::right << std::setw(8) << std::fixed << std::setprecision(1)
+			<< std::chrono::duration<double, std::milli>(last - start).count() << " ms, "
+			<< ready.load() << "/3 publishers saw both peers" << std::endl;
+	}
+
+	// The demo payloads the services send: appId "LARRY", appHealth "HEALTHY".
+	template<typename T>
+	T sampleMessage()
+	{
+		T message;
+		message.appId = "LARRY";
+		message.appHealth = "HEALTHY";
+		return message;
+	}
+
+	// publish() as the caller sees it: encode, then either the send under the
+	// publisher mutex or the push onto the I/O thread's queue. Nobody subscribes,
+	// so the socket discards each message after its filter check and the time is
+	// the publisher's own. The queue holds every message, so none is rejected and
+	// the async numbers are the real encode and push, not a full-queue bail-out.
+	void benchPublish(const ProxyEndpoints& proxy, int threads, bool async)
+	{
+		constexpr int kPerThread = 25000;
+		ZeroMQPublisher publisher(proxy.frontend);
+		publisher.setReadiness({}, std::chrono::milliseconds(0));
+		publisher.init();
+		if (async)
+			publisher.startAsync(static_cast<size_t>(threads) * kPerThread);
+
+		const AppStatus message = sampleMessage<AppStatus>();
+		std::latch go(threads);
+		std::vector<Clock::duration> elapsed(threads);
+		std::vector<std::thread> producers;
+		for (int t = 0; t < threads; ++t) {
+			producers.emplace_back([&, t] {
+				go.arrive_and_wait();
+				const auto start = Clock::now();
+				for (int i = 0; i < kPerThread; ++i)
+					publisher.publish("statusResponseToBench", message);
+				elapsed[t] = Clock::now() - start;
+			});
+		}
+		for (std::thread& producer : producers)
+			producer.join();
+		publisher.stopAsync();
+
+		Clock::duration total{};
+		for (const auto& e : elapsed)
+			total += e;
+		double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(total).count())
+			/ (static_cast<double>(threads) * kPerThread);
+		std::cout << std::left << std::setw(8) << (async ? "async" : "sync")
+			<< std::right << std::setw(8) << threads
+			<< std::setw(14) << std::fixed << std::setprecision(1) << ns
+			<< std::setw(12) << publisher.sendQueueStats().rejected << std::endl;
+	}
+
+	template<typename T>
+	void benchEncoding(const T& message)
+	{
+		const size_t legacySize = MessageCodec::encodedSize(message, WireFormat::Legacy);
+		const size_t compactSize = MessageCodec::encodedSize(message, WireFormat::Compact);
+		std::vector<char> buffer(legacySize > compactSize ? legacySize : compactSize);
+		const size_t reps = 1000000;
+
+		std::cout << std::left << std::setw(18) << MessageSchema<T>::name
+			<< std::right << std::setw(8) << legacySize
+			<< std::setw(9) << compactSize;
+		for (WireFormat format : { WireFormat::Legacy, WireFormat::Compact }) {
+			const size_t size = MessageCodec::encodedSize(message, format);
+			auto start = Clock::now();
+			for (size_t i = 0; i < reps; ++i)
+				MessageCodec::encode(message, buffer.data(), format);
+			auto encodeTime = Clock::now() - start;
+
+			T decoded;
+			start = Clock::now();
+			for (size_t i = 0; i < reps; ++i)
+				MessageCodec::decode(buffer.data(), size, decoded);
+			auto decodeTime = Clock::now() - start;
+
+			std::cout << std::setw(10) << std::fixed << std::setprecision(1)
+				<< std::chrono::duration<double, std::nano>(encodeTime).count() / reps
+				<< std::setw(10) << std::chrono::duration<double, std::nano>(decodeTime).count() / reps;
+		}
+		std::cout << std::endl;
+	}
+}
+
+int main()
+{
+	std::cout << "LzCompressor (ratio = compressed / original)" << std::endl;
+	std::cout << std::left << std::setw(12) << "payload"
+		<< std::right << std::setw(9) << "bytes"
+		<< std::setw(10) << "ratio"
+		<< std::setw(16) << "compress ns/MB"
+		<< std::setw(16) << "decomp ns/MB" << std::endl;
+	for (size_t size : { size_t{ 256 }, size_t{ 4 } << 10, size_t{ 64 } << 10, size_t{ 1 } << 20 }) {
+		benchCompression("repetitive", repetitivePayload(size));
+		benchCompression("structured", structuredPayload(size));
+		benchCompression("random", randomPayload(size));
+	}
+
+	std::cout << std::endl << "MessageCodec payload bytes and ns per message" << std::endl;
+	std::cout << std::left << std::setw(18) << "type"
+		<< std::right << std::setw(8) << "legacy"
+		<< std::setw(9) << "compact"
+		<< std::setw(10) << "leg enc" << std::setw(10) << "leg dec"
+		<< std::setw(10) << "cmp enc" << std::setw(10) << "cmp dec" << std::endl;
+	makeMessageTable<int>([](auto type) {
+		using T = typename decltype(type)::type;
+		if constexpr (SchemaMessage<T>)
+			benchEncoding(sampleMessage<T>());
+		return 0;
+	});
+
+	std::cout << std::endl << "BitWriter / BitReader" << std::endl;
+	benchBitPacking();
+
+	// The in-process proxy binds the real proxy's tcp / ipc endpoints too, so
+	// the socket benchmarks need the Proxy (and the services) to be stopped.
+	InProcessProxy proxy(*ZmqContext::shared());
+	if (!proxy.start()) {
+		std::cout << std::endl << "Socket benchmarks skipped: could not start the in-process proxy (is Proxy running?)" << std::endl;
+		return 0;
+	}
+	const ProxyEndpoints endpoints = proxyEndpoints(ProxyTransport::Inproc);
+
+	std::cout << std::endl << "Service set startup (3 services, readiness timeout "
+		<< ZeroMQPublisher::kDefaultReadyTimeout.count() << " ms)" << std::endl;
+	benchStartup(endpoints, false);
+	benchStartup(endpoints, true);
+
+	std::cout << std::endl << "publish() end to end, AppStatus, ns per call per thread" << std::endl;
+	std::cout << std::left << std::setw(8) << "mode"
+		<< std::right << std::setw(8) << "threads"
+		<< std::setw(14) << "ns/publish"
+		<< std::setw(12) << "queue full" << std::endl;
+	for (bool async : { false, true }) {
+		for (int threads : { 1, 2, 4 })
+			benchPublish(endpoints, threads, async);
+	}
+
+	return 0;
+}
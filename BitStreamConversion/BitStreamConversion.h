@@ -2,8 +2,47 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 #include <type_traits>
 #include <cstring>
+#include <cmath>
+#include <span>
+#include <concepts>
+#include <bit>
+
+// Raw frame types such as zmq::message_t: anything with a const data() that
+// hands out the bytes and a size(). Lets BitStreamConversion read a frame
+// without depending on zmq.hpp; a const zmq::message_t& qualifies.
+template<typename F>
+concept RawFrame = requires(const F & frame) {
+    { frame.data() } -> std::same_as<const void*>;
+    { frame.size() } -> std::convertible_to<size_t>;
+};
+
+// A RawFrame whose bytes can also be written through a non-const data().
+template<typename F>
+concept WritableRawFrame = RawFrame<F> && requires(F & frame) {
+    { frame.data() } -> std::same_as<void*>;
+};
+
+// Static check used by the span based API: true when every byte of T is part of a
+// value, i.e. T has no padding that would leak uninitialized memory onto the wire
+// or make equal values encode differently.
+// Arithmetic types, enums and structs with unique object representations qualify
+// automatically. Structs holding float / double never have unique representations
+// (NaN, -0.0), so specialize this trait for them once their layout is checked, e.g.
+//     template<> struct IsPaddingFree<Telemetry> : std::bool_constant<sizeof(Telemetry) == 2 * sizeof(float)> {};
+template<typename T>
+struct IsPaddingFree : std::bool_constant<
+    std::is_arithmetic<T>::value || std::is_enum<T>::value ||
+    std::has_unique_object_representations<T>::value>
+{
+};
+
+template<typename T, size_t N>
+struct IsPaddingFree<T[N]> : IsPaddingFree<T>
+{
+};
 
 // Simple utility to convert trivially-copyable types to/from a byte-based bitstream.
 // The functions operate on raw bytes (a byte-array bitstream). For arbitrary
@@ -32,4 +71,364 @@ public:
         std::memcpy(&out, bits.data(), sizeof(T));
         return true;
     }
+
+    // Allocation-free variants: write into / read from caller-provided memory.
+    // They require T to be padding free (see IsPaddingFree) on top of trivially
+    // copyable. Each returns false, leaving the destination untouched, when the
+    // buffer is smaller than the data.
+
+    // Write the raw bytes of value to the start of out.
+    template<typename T>
+    static bool ToBitStream(const T& value, std::span<std::byte> out)
+    {
+        CheckFixedLayout<T>();
+        if (out.size() < sizeof(T))
+            return false;
+        std::memcpy(out.data(), &value, sizeof(T));
+        return true;
+    }
+
+    // Read a value from the start of bits.
+    template<typename T>
+    static bool FromBitStream(std::span<const std::byte> bits, T& out)
+    {
+        CheckFixedLayout<T>();
+        if (bits.size() < sizeof(T))
+            return false;
+        std::memcpy(&out, bits.data(), sizeof(T));
+        return true;
+    }
+
+    // Write into a pre-sized frame, e.g. zmq::message_t frame(sizeof(T)).
+    template<typename T, WritableRawFrame F>
+    static bool ToBitStream(const T& value, F& frame)
+    {
+        return ToBitStream(value, std::span<std::byte>(static_cast<std::byte*>(frame.data()), frame.size()));
+    }
+
+    // Read from a received frame.
+    template<typename T, RawFrame F>
+    static bool FromBitStream(const F& frame, T& out)
+    {
+        return FromBitStream(std::span<const std::byte>(static_cast<const std::byte*>(frame.data()), frame.size()), out);
+    }
+
+    // Batched: encode a contiguous array of T in one pass (a single copy, since a
+    // padding free array is laid out exactly as it goes on the wire).
+    template<typename T>
+    static bool ToBitStreamBatch(std::span<const T> values, std::span<std::byte> out)
+    {
+        CheckFixedLayout<T>();
+        if (out.size() < values.size_bytes())
+            return false;
+        std::memcpy(out.data(), values.data(), values.size_bytes());
+        return true;
+    }
+
+    // Batched: decode out.size() consecutive values from bits.
+    template<typename T>
+    static bool FromBitStreamBatch(std::span<const std::byte> bits, std::span<T> out)
+    {
+        CheckFixedLayout<T>();
+        if (bits.size() < out.size_bytes())
+            return false;
+        std::memcpy(out.data(), bits.data(), out.size_bytes());
+        return true;
+    }
+
+private:
+    template<typename T>
+    static constexpr void CheckFixedLayout()
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "BitStreamConversion requires a trivially copyable type");
+        static_assert(IsPaddingFree<T>::value, "T has padding bytes (or holds floating point members; see IsPaddingFree)");
+    }
+};
+
+// Packs values at arbitrary bit widths (1..64) into a byte vector, least significant
+// bit first. Bits are gathered in a 64-bit accumulator and written out a whole word
+// at a time, so most Write() calls are a shift and an OR.
+// Example: a 2-bit health enum, a 20-bit counter and a 10-bit quantized float take
+// 4 bytes instead of the 16+ a byte-aligned struct would need.
+// Call Flush() (or let the destructor do it) before using the output.
+class BitWriter
+{
+public:
+    // Appends to out; existing contents are kept.
+    explicit BitWriter(std::vector<uint8_t>& out)
+        : out_(out), accumulator_(0), pending_(0)
+    {
+    }
+
+    ~BitWriter()
+    {
+        Flush();
+    }
+
+    BitWriter(const BitWriter&) = delete;
+    BitWriter& operator=(const BitWriter&) = delete;
+
+    // Write the low 'bits' bits of value (1..64). Higher bits are ignored.
+    void Write(uint64_t value, unsigned bits)
+    {
+        uint64_t masked = value & Mask(bits);
+        accumulator_ |= masked << pending_;
+        unsigned total = pending_ + bits;
+        if (total >= 64) {
+            AppendWord(accumulator_);
+            total -= 64;
+            // whatever did not fit in the word just written starts the next one
+            accumulator_ = (total == 0) ? 0 : masked >> (bits - total);
+        }
+        pending_ = total;
+    }
+
+    void WriteBool(bool value)
+    {
+        Write(value ? 1u : 0u, 1);
+    }
+
+    // Map value from [min, max] onto 'bits' bits (values outside are clamped).
+    // The step size is (max - min) / (2^bits - 1). An empty range (min >= max) and
+    // NaN have no step to map onto and write 0, which reads back as min.
+    void WriteQuantized(float value, float min, float max, unsigned bits)
+    {
+        if (!(max > min) || std::isnan(value)) {
+            Write(0, bits);
+            return;
+        }
+        const uint64_t steps = Mask(bits);
+        float clamped = value < min ? min : (value > max ? max : value);
+        double scaled = (static_cast<double>(clamped) - min) / (static_cast<double>(max) - min);
+        Write(static_cast<uint64_t>(std::llround(scaled * static_cast<double>(steps))), bits);
+    }
+
+    // Bulk pack count values at the same bit width. The output grows once for all
+    // the whole words the array completes and the accumulator stays in a register,
+    // so each value costs a mask, a shift and an OR plus one store per 64 bits.
+    template<typename T>
+    void WriteArray(const T* values, size_t count, unsigned bits)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "WriteArray requires integral or enum values");
+        const uint64_t mask = Mask(bits);
+        const size_t words = static_cast<size_t>((pending_ + static_cast<uint64_t>(count) * bits) / 64);
+        size_t at = out_.size();
+        out_.resize(at + words * 8);
+        uint8_t* next = out_.data() + at;
+
+        uint64_t accumulator = accumulator_;
+        unsigned pending = pending_;
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t masked = static_cast<uint64_t>(values[i]) & mask;
+            accumulator |= masked << pending;
+            pending += bits;
+            if (pending >= 64) {
+                StoreWord(next, accumulator);
+                next += 8;
+                pending -= 64;
+                accumulator = (pending == 0) ? 0 : masked >> (bits - pending);
+            }
+        }
+        accumulator_ = accumulator;
+        pending_ = pending;
+    }
+
+    // Write out the partially filled accumulator, padding the last byte with zeros.
+    void Flush()
+    {
+        for (unsigned written = 0; written < pending_; written += 8) {
+            out_.push_back(static_cast<uint8_t>(accumulator_));
+            accumulator_ >>= 8;
+        }
+        accumulator_ = 0;
+        pending_ = 0;
+    }
+
+    static uint64_t Mask(unsigned bits)
+    {
+        return bits >= 64 ? ~uint64_t{ 0 } : ((uint64_t{ 1 } << bits) - 1);
+    }
+
+private:
+    void AppendWord(uint64_t word)
+    {
+        size_t at = out_.size();
+        out_.resize(at + 8);
+        StoreWord(out_.data() + at, word);
+    }
+
+    // Little-endian store of word to the 8 bytes at at.
+    static void StoreWord(uint8_t* at, uint64_t word)
+    {
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(at, &word, sizeof(word));
+        }
+        else {
+            for (size_t i = 0; i < 8; ++i)
+                at[i] = static_cast<uint8_t>(word >> (8 * i));
+        }
+    }
+
+    std::vector<uint8_t>& out_;
+    uint64_t accumulator_; // bits not yet written, LSB first
+    unsigned pending_;     // number of valid bits in accumulator_ (0..63)
+};
+
+// Reads values written by BitWriter, using the same widths in the same order.
+// The accumulator is refilled with one unaligned 64-bit load while at least 8
+// bytes remain. Reading past the end returns zeros and clears Good(), so a batch
+// of fields can be read and checked once.
+class BitReader
+{
+public:
+    BitReader(const uint8_t* data, size_t size)
+        : data_(data), size_(size), pos_(0), accumulator_(0), available_(0), good_(true)
+    {
+    }
+
+    explicit BitReader(const std::vector<uint8_t>& bits)
+        : BitReader(bits.data(), bits.size())
+    {
+    }
+
+    // Read 'bits' bits (1..64).
+    uint64_t Read(unsigned bits)
+    {
+        if (bits > 56) {
+            // the accumulator holds at most 56 fresh bits after a refill
+            uint64_t low = Read(32);
+            return low | (Read(bits - 32) << 32);
+        }
+        if (available_ < bits) {
+            Refill();
+            if (available_ < bits) {
+                good_ = false;
+                available_ = 0;
+                accumulator_ = 0;
+                return 0;
+            }
+        }
+        uint64_t value = accumulator_ & BitWriter::Mask(bits);
+        accumulator_ >>= bits;
+        available_ -= bits;
+        return value;
+    }
+
+    bool ReadBool()
+    {
+        return Read(1) != 0;
+    }
+
+    // Inverse of BitWriter::WriteQuantized with the same min, max and bits.
+    float ReadQuantized(float min, float max, unsigned bits)
+    {
+        if (!(max > min)) {
+            Read(bits);
+            return min;
+        }
+        const uint64_t steps = BitWriter::Mask(bits);
+        double scaled = static_cast<double>(Read(bits)) / static_cast<double>(steps);
+        return static_cast<float>(min + scaled * (static_cast<double>(max) - min));
+    }
+
+    // Bulk unpack count values at the same bit width. When the whole array is in
+    // the buffer and bits <= 56, values are cut straight out of unaligned 64-bit
+    // loads (57 / bits of them per load) with no refill bookkeeping in between.
+    // Otherwise (wide values, or an array running past the end) it reads value by
+    // value so Good() reports the overrun.
+    template<typename T>
+    void ReadArray(T* values, size_t count, unsigned bits)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "ReadArray requires integral or enum values");
+        const uint64_t start = static_cast<uint64_t>(pos_) * 8 - available_;
+        const uint64_t end = start + static_cast<uint64_t>(count) * bits;
+        if (bits > 56 || end > static_cast<uint64_t>(size_) * 8) {
+            for (size_t i = 0; i < count; ++i)
+                values[i] = static_cast<T>(Read(bits));
+            return;
+        }
+
+        const uint64_t mask = BitWriter::Mask(bits);
+        // a load shifted to any bit offset still holds 57 valid bits
+        const unsigned perLoad = 57 / bits;
+        size_t bit = static_cast<size_t>(start);
+        size_t i = 0;
+        for (; i + perLoad <= count && (bit >> 3) + 8 <= size_; bit += perLoad * bits) {
+            uint64_t word = LoadWord(data_ + (bit >> 3)) >> (bit & 7);
+            for (unsigned k = 0; k < perLoad; ++k, word >>= bits)
+                values[i++] = static_cast<T>(word & mask);
+        }
+        for (; i < count; ++i, bit += bits)
+            values[i] = static_cast<T>((LoadTail(bit >> 3) >> (bit & 7)) & mask);
+        Seek(end);
+    }
+
+    // False once a read ran past the end of the buffer.
+    bool Good() const
+    {
+        return good_;
+    }
+
+private:
+    void Refill()
+    {
+        if (pos_ + 8 <= size_) {
+            // fast path: load a whole word and keep as many complete bytes as fit.
+            // Bits above available_ may already hold the next bytes; OR-ing the
+            // same bytes in again on the next refill is harmless.
+            accumulator_ |= LoadWord(data_ + pos_) << available_;
+            unsigned bytes = (63 - available_) >> 3;
+            pos_ += bytes;
+            available_ += bytes * 8;
+            return;
+        }
+        while (available_ <= 56 && pos_ < size_) {
+            accumulator_ |= static_cast<uint64_t>(data_[pos_++]) << available_;
+            available_ += 8;
+        }
+    }
+
+    // Little-endian load of the 8 bytes at at.
+    static uint64_t LoadWord(const uint8_t* at)
+    {
+        uint64_t word = 0;
+        if constexpr (std::endian::native == std::endian::little) {
+            std::memcpy(&word, at, sizeof(word));
+        }
+        else {
+            for (size_t i = 0; i < 8; ++i)
+                word |= static_cast<uint64_t>(at[i]) << (8 * i);
+        }
+        return word;
+    }
+
+    // LoadWord for the last bytes of the buffer: bytes past the end read as 0.
+    uint64_t LoadTail(size_t at) const
+    {
+        uint64_t word = 0;
+        for (size_t i = 0; at + i < size_ && i < 8; ++i)
+            word |= static_cast<uint64_t>(data_[at + i]) << (8 * i);
+        return word;
+    }
+
+    // Continue reading at absolute bit offset bit (<= size_ * 8): drop the
+    // accumulator and reload the partial byte bit falls in, if any.
+    void Seek(uint64_t bit)
+    {
+        pos_ = static_cast<size_t>(bit / 8);
+        accumulator_ = 0;
+        available_ = 0;
+        const unsigned skip = static_cast<unsigned>(bit % 8);
+        if (skip != 0) {
+            accumulator_ = static_cast<uint64_t>(data_[pos_++]) >> skip;
+            available_ = 8 - skip;
+        }
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;           // next byte not yet in the accumulator
+    uint64_t accumulator_; // unread bits, LSB first
+    unsigned available_;   // number of unread bits in accumulator_
+    bool good_;
 };
@@ -76,6 +76,9 @@ bool App::Initialize(HINSTANCE hInstance, int nCmdShow)
     m_appRuntimeStart = clock();
     running_ = true;
 
+    // fill the payload jump table used by DoWork
+    RegisterMessageHandlers();
+
     WNDCLASSEXW wc = {};
     wc.cbSize = sizeof(wc);
     wc.style = CS_HREDRAW | CS_VREDRAW;
@@ -175,26 +178,18 @@ bool App::Initialize(HINSTANCE hInstance, int nCmdShow)
     ShowWindow(m_hWnd, nCmdShow);
     UpdateWindow(m_hWnd);
 
-    // Initialize ZeroMQ publisher to connect to the proxy frontend socket
-    try {
-        m_publisher = std::make_unique<ZeroMQPublisher>(PROXYFRONTEND);
-        if (!m_publisher->init()) {
-            // Initialization failed; keep the pointer so publish() can attempt init lazily.
-            OutputDebugStringA("ZeroMQ publisher init failed\n");
-        }
-    }
-    catch (const std::exception& ex) {
-        // If ZeroMQ or allocation throws, log but continue running the UI
-        OutputDebugStringA(ex.what());
-    }
+    // Pick the closest transport to the proxy: inproc, then ipc (same host), then tcp
+    const ProxyEndpoints proxy = proxyEndpoints();
 
+    // Subscribe before the publisher waits for the other services, so services started
+    // together see each other's subscriptions instead of all waiting out the timeout
     // Initialize ZeroMQ subscriber to connect to the proxy backend socket for messages in background and post to UI
     try {
 	
         // THESE ARE THE TOPICS THAT DUMMY2 LISTENS TO, THIS IS ALL-CAPS 'CAUSE IT'S REALLY IMPORTANT
 		// AND HARD TO DEBUG IF THERE ISN'T TOPIC ALIGNMENT BETWEEN THE SERVICES
 		// connect to proxy
-        m_subscriber = std::make_unique<ZeroMQSubscriber>(PROXYBACKEND, std::vector<std::string>{
+        m_subscriber = std::make_unique<ZeroMQSubscriber>(proxy.backend, std::vector<std::string>{
             //because of using a Proxy, we have to have really specific topics right now
 
             //listening for 1 and/or 3's requests
@@ -208,7 +203,7 @@ bool App::Initialize(HINSTANCE hInstance, int nCmdShow)
             //listening for 1 and 3's response to OUR request
 			"statusResponseTo2",
 			"additionResponseTo2",
-			"multiplicationReponseTo2"
+			"multiplicationResponseTo2"
         }); 
         if (!m_subscriber->init()) {
             return false;
@@ -221,6 +216,23 @@ bool App::Initialize(HINSTANCE hInstance, int nCmdShow)
         OutputDebugStringA(ex.what());
     }
 
+    // Initialize ZeroMQ publisher to connect to the proxy frontend socket
+    try {
+        m_publisher = std::make_unique<ZeroMQPublisher>(proxy.frontend);
+        // init() waits (bounded, best-effort) until both other services subscribe to our requests
+        m_publisher->setReadiness({ "statusRequestFrom2", "additionRequestFrom2", "multiplicationRequestFrom2" },
+            ZeroMQPublisher::kDefaultReadyTimeout, 2);
+        if (!m_publisher->init()) {
+            // Initialization failed; keep the pointer so publish() can attempt init lazily.
+            OutputDebugStringA("ZeroMQ publisher init failed\n");
+        }
+        m_statusReplies = std::make_unique<ZeroMQPublisher::Batch>(*m_publisher);
+    }
+    catch (const std::exception& ex) {
+        // If ZeroMQ or allocation throws, log but continue running the UI
+        OutputDebugStringA(ex.what());
+    }
+
     return true;
 }
 
@@ -233,9 +245,12 @@ int App::Run()
     outputThread_ = std::thread(&App::OutputThread, this);
 
     CreateConsoleWindow();
+    // DoWork (publishing, message boxes) runs on a worker thread so it never holds up
+    // receiving; one worker keeps m_workQueue and m_topic single threaded
+    m_subscriber->setWorkerThreads(1);
     // start receiving; callback will post WM_ZMQ_MESSAGE to UI thread
     // if loop breaks from sent message, save off topic/payload and send Windows API call 
-    m_subscriber->start([this](const std::string& topic, std::unique_ptr<Message> message)
+    m_subscriber->start([this](const std::string& topic, MessagePtr message)
         {
             // put the topic and payload into a queue and signal that the app has work to do
             m_topic = topic;
@@ -473,10 +488,9 @@ void App::DoWork(const std::string receivedTopic)
 
      while (!m_workQueue.empty())
      {
-         std::unique_ptr<Message> payload = std::move(m_workQueue.front());
+         MessagePtr payload = std::move(m_workQueue.front());
          m_workQueue.pop();
          
-         std::string responseTopic = {};
          std::string output = {};        // text to display on console window
 
          // ******* THESE ARE REQUEST TOPICS  ********  //
@@ -484,78 +498,69 @@ void App::DoWork(const std::string receivedTopic)
 
          if (!payload) // handle purely a request
          {
-             if (receivedTopic == "statusRequestFrom1" || receivedTopic == "statusRequestFrom3")
+             // the topic registry says what the request asks for and which topic the answer goes out on
+             const TopicRoute* route = m_subscriber ? m_subscriber->topicRoute(receivedTopic) : nullptr;
+             if (!route || route->kind != TopicKind::Request)
+                 continue;
+
+             auto reply = [this, route](const auto& A)
+                 {
+                     if (m_publisher)
+                     {
+                         bool published = m_publisher->publish(route->replyTopic, A);
+                         if (published)
+                         {
+                             MessageBoxW(m_hWnd, L"Response published successfully.", L"Info", MB_OK | MB_ICONINFORMATION);
+                         }
+                         else
+                         {
+                             MessageBoxW(m_hWnd, L"Failed to publish response.", L"Error", MB_OK | MB_ICONERROR);
+                         }
+                     }
+                 };
+
+             switch (route->typeId)
+             {
+             case MessageTypeId::AppStatus:
              {
-                 responseTopic = (receivedTopic == "statusRequestFrom1") ? "statusResponseTo1" : "statusResponseTo3";
                  AppStatus A;
                  A.appId = m_appId;
                  A.appHealth = DetermineAppHealth();
                  A.appRuntime = GetAppRunningTime();
 
                  // print out the data so the user can verify
-
                  output = "I'm sending my id: "+ A.appId + " health: " + A.appHealth + " and running time: " + std::to_string(A.appRuntime);
-
-                 if (m_publisher)
-                 {
-                     bool published = m_publisher->publish(responseTopic, A);
-                     if (published)
-                     {
-                         MessageBoxW(m_hWnd, L"Response published successfully.", L"Info", MB_OK | MB_ICONINFORMATION);
-                     }
-                     else
-                     {
-                         MessageBoxW(m_hWnd, L"Failed to publish response.", L"Error", MB_OK | MB_ICONERROR);
-                     }
-                 }
+                 // status requests come in bursts, so the replies go out together
+                 if (m_statusReplies)
+                     m_statusReplies->add(route->replyTopic, A);
+                 else
+                     reply(A);
+                 break;
              }
-             else if (receivedTopic == "additionRequestFrom1" || receivedTopic == "additionRequestFrom3")
+             case MessageTypeId::AppDataRequest1:
              {
-                 responseTopic = (receivedTopic == "additionRequestFrom1") ? "additionResponseTo1" : "additionResponseTo3";
                  AppDataRequest1 A;
-
                  A.appId = m_appId;
                  A.appHealth = DetermineAppHealth();
                  A.numberToAdd = m_numToAdd;
 
                  output = "I'm sending my id: " + A.appId + " health: " + A.appHealth + " number to add with: " + std::to_string(A.numberToAdd);
-
-                 if (m_publisher)
-                 {
-                     bool published = m_publisher->publish(responseTopic, A);
-                     if (published)
-                     {
-                         MessageBoxW(m_hWnd, L"Response published successfully.", L"Info", MB_OK | MB_ICONINFORMATION);
-                     }
-                     else
-                     {
-                         MessageBoxW(m_hWnd, L"Failed to publish response.", L"Error", MB_OK | MB_ICONERROR);
-                     }
-                 }
+                 reply(A);
+                 break;
              }
-             else if (receivedTopic == "multiplicationRequestFrom2" || receivedTopic == "multiplicationRequestFrom3")
+             case MessageTypeId::AppDataRequest2:
              {
-
-                 responseTopic = (receivedTopic == "multiplicationRequestFrom2") ? "multiplicationResponseTo1" : "multiplicationResponseTo3";
                  AppDataRequest2 A;
                  A.appId = m_appId;
                  A.appHealth = DetermineAppHealth();
                  A.numberToMultiply = m_numToMultiply;
 
                  output = "I'm sending my id: " + A.appId + " health: " + A.appHealth + " and number to multiply with: " + std::to_string(A.numberToMultiply);
-
-                 if (m_publisher)
-                 {
-                     bool published = m_publisher->publish(responseTopic, A);
-                     if (published)
-                     {
-                         MessageBoxW(m_hWnd, L"Response published successfully.", L"Info", MB_OK | MB_ICONINFORMATION);
-                     }
-                     else
-                     {
-                         MessageBoxW(m_hWnd, L"Failed to publish response.", L"Error", MB_OK | MB_ICONERROR);
-                     }
-                 }
+                 reply(A);
+                 break;
+             }
+             default:
+                 continue;
              }
              AsyncPrint(output);
              continue;
@@ -564,31 +569,36 @@ void App::DoWork(const std::string receivedTopic)
          {
              // ******* THESE ARE SENT PAYLOADS  ******* //
              // work on the sent payload on the workQueue
-             // ascertain the sent struct type, fill data, and build text string
-
-             if (AppStatus* s = dynamic_cast<AppStatus*>(payload.get()))
-             {
-                 // do status stuff
-                 output = s->appId + " is " + s->appHealth + " and has been running for " + std::to_string(s->appRuntime);
-             }
-
-             else if (AppDataRequest1* a = dynamic_cast<AppDataRequest1*>(payload.get()))
-             {
-                 // do addition stuff
-                 output = a->appId + " is " + a->appHealth + " has number to add of " + std::to_string(a->numberToAdd);
-             }
-
-             else if (AppDataRequest2* m = dynamic_cast<AppDataRequest2*>(payload.get()))
-             {
-                 // do mulitplication stuff
-                 output = m->appId + " is " + m->appHealth + " has number to multiply of  " + std::to_string(m->numberToMultiply);
-             }
-             AsyncPrint(output);
+             // the handler registered for the payload's type ID fills data and prints the text
+             m_dispatcher.dispatch(*payload);
          };
      }; 
      m_iHaveWorkToDo = false;
 }
 
+ // RegisterMessageHandlers: one handler per payload type, stored in a flat table indexed
+ // by the type ID carried in each message (replaces the old dynamic_cast chain)
+ void App::RegisterMessageHandlers()
+ {
+     m_dispatcher.registerHandler<AppStatus>([this](AppStatus& s)
+         {
+             // do status stuff
+             AsyncPrint(s.appId + " is " + s.appHealth + " and has been running for " + std::to_string(s.appRuntime));
+         });
+
+     m_dispatcher.registerHandler<AppDataRequest1>([this](AppDataRequest1& a)
+         {
+             // do addition stuff
+             AsyncPrint(a.appId + " is " + a.appHealth + " has number to add of " + std::to_string(a.numberToAdd));
+         });
+
+     m_dispatcher.registerHandler<AppDataRequest2>([this](AppDataRequest2& m)
+         {
+             // do mulitplication stuff
+             AsyncPrint(m.appId + " is " + m.appHealth + " has number to multiply of  " + std::to_string(m.numberToMultiply));
+         });
+ }
+
  void App::OutputThread() {
 
      while (running_) {
@@ -14,6 +14,8 @@
 #include <atomic>
 // Forward declare or include ZeroMQ publisher helper
 #include "ZeroMQ.h"
+// Flat MessageTypeId -> handler table for received payloads
+#include "MessageDispatch.h"
 // Include of Proxy port constants for Pubs/Subs connections
 #include "Proxy.h"
 
@@ -75,7 +77,7 @@ private:
     std::atomic<bool> running_;   
     std::thread outputThread_;
 
-    std::queue <std::unique_ptr<Message>> m_workQueue; 	  // Queue for storing topics and payloads to work on
+    std::queue <MessagePtr> m_workQueue; 	  // Queue for storing topics and payloads to work on
     bool m_iHaveWorkToDo;                                 // flag for the app to know that there is work to be done
 
     // data that each App has to be initialized at runtime and requested from other apps
@@ -98,12 +100,22 @@ private:
     // Handler invoked when the button is clicked.
     void OnButtonClicked();
 
+    // Registers the per-type payload handlers in m_dispatcher.
+    void RegisterMessageHandlers();
+
+    // Payload handlers indexed by MessageTypeId, used by DoWork
+    MessageDispatcher m_dispatcher;
+
     const wchar_t* m_windowClassName = L"BasicAppWindowClass";
     const wchar_t* m_windowTitle = L"Dummy Service 3";
 
     // ZeroMQ publisher used to send messages when the button is clicked
     std::unique_ptr<ZeroMQPublisher> m_publisher;
 
+    // Status replies are batched: a burst of statusRequest topics is answered with
+    // one publishBatch(), and the batch timer sends a lone reply within maxLatency
+    std::unique_ptr<ZeroMQPublisher::Batch> m_statusReplies;
+
     // ZeroMQ subscriber used to receive messages in the background
     std::unique_ptr<ZeroMQSubscriber> m_subscriber;
 };
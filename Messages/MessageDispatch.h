@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <type_traits>
+#include "Messages.h"
+
+// Flat jump table from MessageTypeId to a handler.
+// Handlers are registered per struct type and stored at the index of the type's
+// kTypeId, so dispatch is one bounds check and an indexed call: no dynamic_cast
+// chain, and the cost does not grow with the number of message types.
+class MessageDispatcher
+{
+public:
+    using Handler = std::function<void(Message&)>;
+
+    // Register the handler for message type T (replaces any previous one).
+    template<typename T>
+    void registerHandler(std::function<void(T&)> handler)
+    {
+        static_assert(std::is_base_of<Message, T>::value, "handlers are registered for Messages.h types");
+        // the type ID guarantees the dynamic type, so a static_cast is enough
+        handlers_[static_cast<size_t>(T::kTypeId)] = [handler = std::move(handler)](Message& message) {
+            handler(static_cast<T&>(message));
+        };
+    }
+
+    // Invoke the handler registered for message.typeId.
+    // Returns false if no handler is registered for that type.
+    bool dispatch(Message& message) const
+    {
+        size_t index = static_cast<size_t>(message.typeId);
+        if (index >= handlers_.size() || !handlers_[index])
+            return false;
+        handlers_[index](message);
+        return true;
+    }
+
+private:
+    std::array<Handler, kMessageTypeCount> handlers_;
+};
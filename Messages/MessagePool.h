@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Messages.h"
+
+// Deleter for pooled messages: hands the object back to the pool it came from
+// instead of freeing it. A null release means the message was allocated with new.
+struct MessageDeleter
+{
+    void (*release)(Message*) = nullptr;
+
+    void operator()(Message* message) const
+    {
+        if (release)
+            release(message);
+        else
+            delete message;
+    }
+};
+
+// Owning pointer handed to subscriber callbacks. Dropping it recycles the message.
+using MessagePtr = std::unique_ptr<Message, MessageDeleter>;
+
+struct MessagePoolStats
+{
+    uint64_t hits;   // acquire() served from the idle list
+    uint64_t misses; // acquire() had to allocate
+    size_t idle;     // objects currently waiting for reuse
+};
+
+// Process-wide free list of T objects for the subscriber hot path.
+// Recycled objects keep their std::string capacity, so once the pool has warmed
+// up, decoding a message into an acquired object allocates nothing.
+// The pools are function-local statics and outlive every App, so a message can
+// be released after the subscriber that produced it is gone.
+// acquire() and release are thread-safe.
+template<typename T>
+class MessagePool
+{
+public:
+    static MessagePool& shared()
+    {
+        static MessagePool pool;
+        return pool;
+    }
+
+    // Take a recycled object if one is idle, otherwise allocate a new one.
+    // Field values of a recycled object are stale; the caller overwrites them.
+    std::unique_ptr<T, MessageDeleter> acquire()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!idle_.empty()) {
+                T* message = idle_.back();
+                idle_.pop_back();
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return std::unique_ptr<T, MessageDeleter>(message, MessageDeleter{ &MessagePool::recycle });
+            }
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::unique_ptr<T, MessageDeleter>(new T(), MessageDeleter{ &MessagePool::recycle });
+    }
+
+    // Upper bound on idle objects kept for reuse; extra releases are freed.
+    void setMaxIdle(size_t maxIdle)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxIdle_ = maxIdle;
+        while (idle_.size() > maxIdle_) {
+            delete idle_.back();
+            idle_.pop_back();
+        }
+        // reserve up front so recycle() never grows the vector
+        idle_.reserve(maxIdle_);
+    }
+
+    MessagePoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return MessagePoolStats{ hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed), idle_.size() };
+    }
+
+    ~MessagePool()
+    {
+        for (T* message : idle_)
+            delete message;
+    }
+
+private:
+    MessagePool()
+    {
+        idle_.reserve(maxIdle_);
+    }
+
+    MessagePool(const MessagePool&) = delete;
+    MessagePool& operator=(const MessagePool&) = delete;
+
+    static void recycle(Message* message)
+    {
+        MessagePool& pool = shared();
+        T* typed = static_cast<T*>(message);
+        {
+            std::lock_guard<std::mutex> lock(pool.mutex_);
+            if (pool.idle_.size() < pool.maxIdle_) {
+                pool.idle_.push_back(typed);
+                return;
+            }
+        }
+        delete typed;
+    }
+
+    std::mutex mutex_;
+    std::vector<T*> idle_;
+    size_t maxIdle_ = 64;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+};
@@ -0,0 +1,489 @@
+#pragma once
+
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <stdexcept>
+#include "Messages.h"
+
+// Compile-time field descriptors for the structs in Messages.h.
+// Each message type specializes MessageSchema<T> with its name and a tuple of
+// pointers to its data members, listed in wire order. MessageCodec walks that
+// tuple at compile time to generate the encoder / decoder, so adding a new
+// message type only takes one descriptor here instead of new serialize /
+// deserialize functions.
+// NOTE: the name and the field types feed the schema hash of the compact wire
+// format, so reordering or retyping fields changes the hash on purpose.
+template<typename T>
+struct MessageSchema; // intentionally undefined: unknown types fail to compile
+
+template<>
+struct MessageSchema<AppStatus>
+{
+    static constexpr char name[] = "AppStatus";
+    static constexpr auto fields = std::make_tuple(
+        &AppStatus::appId,
+        &AppStatus::appHealth,
+        &AppStatus::appRuntime);
+};
+
+template<>
+struct MessageSchema<AppDataRequest1>
+{
+    static constexpr char name[] = "AppDataRequest1";
+    static constexpr auto fields = std::make_tuple(
+        &AppDataRequest1::appId,
+        &AppDataRequest1::appHealth,
+        &AppDataRequest1::numberToAdd);
+};
+
+template<>
+struct MessageSchema<AppDataRequest2>
+{
+    static constexpr char name[] = "AppDataRequest2";
+    static constexpr auto fields = std::make_tuple(
+        &AppDataRequest2::appId,
+        &AppDataRequest2::appHealth,
+        &AppDataRequest2::numberToMultiply);
+};
+
+// Number of fields in T's descriptor and the type of field I.
+template<typename T>
+constexpr size_t MessageFieldCount = std::tuple_size<decltype(MessageSchema<T>::fields)>::value;
+
+template<typename P>
+struct MemberPointerTraits;
+
+template<typename C, typename M>
+struct MemberPointerTraits<M C::*>
+{
+    using type = M;
+};
+
+template<typename T, size_t I>
+using MessageFieldType = typename MemberPointerTraits<
+    std::tuple_element_t<I, std::decay_t<decltype(MessageSchema<T>::fields)>>>::type;
+
+// Types MessageCodec can encode: a MessageSchema descriptor plus the wire type ID.
+template<typename T>
+concept SchemaMessage = requires {
+    MessageSchema<T>::fields;
+    { T::kTypeId } -> std::convertible_to<MessageTypeId>;
+};
+
+// Payload encodings understood by MessageCodec.
+// - Legacy:  what the original hand-written serialize() produced. Strings carry a
+//            raw size_t length prefix and scalars are raw host bytes, so it only
+//            works between peers with the same word size and endianness.
+// - Compact: portable and versioned. A 7 byte header (format version, flags,
+//            MessageTypeId, little-endian schema hash of the type) followed by the
+//            fields with LEB128 varint string lengths and little-endian scalars.
+// Sizes for the demo payloads ("LARRY" / "HEALTHY"), as printed by Bench:
+//            AppStatus 36 -> 29 bytes, AppDataRequest1 32 -> 25, AppDataRequest2 32 -> 25
+enum class WireFormat : uint8_t
+{
+    Legacy,
+    Compact
+};
+
+// Field encoding for WireFormat::Legacy.
+struct LegacyWireFormat
+{
+    static size_t lengthSize(size_t) { return sizeof(size_t); }
+
+    static char* writeLength(char* ptr, size_t length)
+    {
+        std::memcpy(ptr, &length, sizeof(length));
+        return ptr + sizeof(length);
+    }
+
+    static const char* readLength(const char* ptr, const char* end, size_t& length)
+    {
+        if (sizeof(length) > static_cast<size_t>(end - ptr))
+            throw std::runtime_error("Buffer underflow");
+        std::memcpy(&length, ptr, sizeof(length));
+        return ptr + sizeof(length);
+    }
+
+    template<typename F>
+    static char* writeScalar(char* ptr, F value)
+    {
+        std::memcpy(ptr, &value, sizeof(F));
+        return ptr + sizeof(F);
+    }
+
+    template<typename F>
+    static F readScalar(const char* at)
+    {
+        F value;
+        std::memcpy(&value, at, sizeof(F));
+        return value;
+    }
+};
+
+// Field encoding for WireFormat::Compact.
+struct CompactWireFormat
+{
+    // longest LEB128 encoding of a 64-bit length
+    static constexpr size_t kMaxVarintSize = 10;
+
+    static size_t lengthSize(size_t length)
+    {
+        size_t size = 1;
+        while (length >= 0x80) {
+            length >>= 7;
+            ++size;
+        }
+        return size;
+    }
+
+    static char* writeLength(char* ptr, size_t length)
+    {
+        while (length >= 0x80) {
+            *ptr++ = static_cast<char>((length & 0x7F) | 0x80);
+            length >>= 7;
+        }
+        *ptr++ = static_cast<char>(length);
+        return ptr;
+    }
+
+    static const char* readLength(const char* ptr, const char* end, size_t& length)
+    {
+        length = 0;
+        for (size_t i = 0; i < kMaxVarintSize; ++i) {
+            if (ptr == end)
+                throw std::runtime_error("Buffer underflow");
+            uint8_t byte = static_cast<uint8_t>(*ptr++);
+            length |= static_cast<size_t>(byte & 0x7F) << (7 * i);
+            if ((byte & 0x80) == 0)
+                return ptr;
+        }
+        throw std::runtime_error("Malformed varint length");
+    }
+
+    // scalars go through an unsigned integer of the same width so the byte order
+    // on the wire is little-endian whatever the host is
+    template<typename F>
+    static char* writeScalar(char* ptr, F value)
+    {
+        using Bits = UnsignedOfSize<sizeof(F)>;
+        Bits bits;
+        std::memcpy(&bits, &value, sizeof(F));
+        for (size_t i = 0; i < sizeof(F); ++i)
+            ptr[i] = static_cast<char>(static_cast<uint64_t>(bits) >> (8 * i));
+        return ptr + sizeof(F);
+    }
+
+    template<typename F>
+    static F readScalar(const char* at)
+    {
+        using Bits = UnsignedOfSize<sizeof(F)>;
+        uint64_t bits = 0;
+        for (size_t i = 0; i < sizeof(F); ++i)
+            bits |= static_cast<uint64_t>(static_cast<uint8_t>(at[i])) << (8 * i);
+        Bits narrowed = static_cast<Bits>(bits);
+        F value;
+        std::memcpy(&value, &narrowed, sizeof(F));
+        return value;
+    }
+
+    template<size_t N>
+    using UnsignedOfSize = std::conditional_t<N == 1, uint8_t,
+        std::conditional_t<N == 2, uint16_t,
+        std::conditional_t<N == 4, uint32_t, uint64_t>>>;
+};
+
+// Encoder / decoder generated from MessageSchema<T>.
+// encodedSize() is computed up front so callers can write straight into a
+// pre-sized buffer (e.g. a zmq::message_t) without an intermediate stream.
+// Decoding detects the format per buffer: a compact header whose version, type
+// ID and schema hash match T selects Compact, anything else is parsed as Legacy, so
+// a subscriber keeps reading legacy publishers. The format is not negotiated: PUB/SUB
+// gives a publisher no per-peer channel, and subscribers built before the compact
+// format could not take part anyway. Publishers are switched by hand with
+// ZeroMQPublisher::setWireFormat() until every subscriber reads Compact.
+class MessageCodec
+{
+public:
+    static constexpr uint8_t kCompactVersion = 0x82; // high bit set: unlikely as a legacy length byte
+    static constexpr size_t kCompactHeaderSize = 7;  // version, flags, type id, 4 byte schema hash
+    static constexpr size_t kCompactFlagsOffset = 1;
+
+    // Frame level flags in the compact header. The transport sets and handles them
+    // (ZeroMQPublisher / ZeroMQSubscriber) and tells the decoder which ones it has
+    // handled through handledFlags; any other flag makes decoding throw.
+    static constexpr uint8_t kFlagCompressed = 0x01; // body is [varint size][LzCompressor block]
+    static constexpr uint8_t kFlagChecksum = 0x02;   // frame ends in a CRC32C trailer over everything before it
+    static constexpr size_t kChecksumSize = 4;       // little-endian CRC32C
+
+    // FNV-1a over the schema name and the kind / width of every field.
+    template<typename T>
+    static constexpr uint32_t schemaHash()
+    {
+        uint32_t hash = 2166136261u;
+        for (const char* c = MessageSchema<T>::name; *c != '\0'; ++c)
+            hash = mixHash(hash, static_cast<uint8_t>(*c));
+        return hashFields<T>(hash, std::make_index_sequence<MessageFieldCount<T>>{});
+    }
+
+    // Exact number of bytes encode() will write for this message.
+    template<typename T>
+    static size_t encodedSize(const T& message, WireFormat format = WireFormat::Compact)
+    {
+        if (format == WireFormat::Compact)
+            return kCompactHeaderSize + fieldsSize<CompactWireFormat>(message);
+        return fieldsSize<LegacyWireFormat>(message);
+    }
+
+    // Write the message into out, which must hold at least encodedSize(message, format) bytes.
+    // Returns a pointer one past the last byte written.
+    template<typename T>
+    static char* encode(const T& message, void* out, WireFormat format = WireFormat::Compact)
+    {
+        char* ptr = static_cast<char*>(out);
+        if (format == WireFormat::Compact) {
+            *ptr++ = static_cast<char>(kCompactVersion);
+            *ptr++ = 0; // flags: set later by the transport, if at all
+            *ptr++ = static_cast<char>(T::kTypeId);
+            ptr = CompactWireFormat::writeScalar(ptr, schemaHash<T>());
+            return encodeFields<CompactWireFormat>(message, ptr);
+        }
+        return encodeFields<LegacyWireFormat>(message, ptr);
+    }
+
+    // Which format an encoded T is in.
+    // Throws std::runtime_error if it is compact and sets a flag outside handledFlags.
+    template<typename T>
+    static WireFormat detectFormat(const void* data, size_t size, uint8_t handledFlags = 0)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        if (size < kCompactHeaderSize || static_cast<uint8_t>(bytes[0]) != kCompactVersion)
+            return WireFormat::Legacy;
+        if (static_cast<uint8_t>(bytes[2]) != static_cast<uint8_t>(T::kTypeId) ||
+            CompactWireFormat::readScalar<uint32_t>(bytes + 3) != schemaHash<T>())
+            return WireFormat::Legacy;
+        if ((static_cast<uint8_t>(bytes[1]) & ~handledFlags) != 0)
+            throw std::runtime_error("Unsupported wire format flags");
+        return WireFormat::Compact;
+    }
+
+    // Type of an encoded payload as carried in its compact header, or
+    // MessageTypeId::None for legacy payloads (which carry no ID; the receiver
+    // falls back to the topic). The schema hash is checked too, so a legacy frame
+    // can not be mistaken for a compact one.
+    static MessageTypeId peekTypeId(const void* data, size_t size);
+
+    // Flags byte of a valid compact header, 0 for legacy payloads.
+    static uint8_t peekFlags(const void* data, size_t size);
+
+    // Decode size bytes at data into message. String members are assigned in place
+    // so an existing message keeps its string capacity. handledFlags are the frame
+    // flags the caller has already dealt with (see detectFormat).
+    // Throws std::runtime_error("Buffer underflow") if the buffer is too short.
+    template<typename T>
+    static void decode(const void* data, size_t size, T& message, uint8_t handledFlags = 0)
+    {
+        const char* ptr = static_cast<const char*>(data);
+        const char* end = ptr + size;
+        if (detectFormat<T>(data, size, handledFlags) == WireFormat::Compact)
+            decodeFields<CompactWireFormat>(ptr + kCompactHeaderSize, end, message);
+        else
+            decodeFields<LegacyWireFormat>(ptr, end, message);
+    }
+
+    template<typename T>
+    static T decode(const void* data, size_t size, uint8_t handledFlags = 0)
+    {
+        T message;
+        decode(data, size, message, handledFlags);
+        return message;
+    }
+
+    // Where a field's bytes sit inside an encoded buffer: for strings the span covers
+    // the characters only, for arithmetic members the encoded scalar.
+    struct FieldSpan
+    {
+        size_t offset;
+        size_t length;
+    };
+
+    // Walk an encoded T without copying anything and record the span of every field
+    // in spans[0 .. MessageFieldCount<T>). Used by the zero-copy message views.
+    // Returns the detected format, which readScalar() needs.
+    // Throws std::runtime_error("Buffer underflow") if the buffer is too short.
+    template<typename T>
+    static WireFormat locate(const void* data, size_t size, FieldSpan* spans, uint8_t handledFlags = 0)
+    {
+        const char* begin = static_cast<const char*>(data);
+        const char* end = begin + size;
+        WireFormat format = detectFormat<T>(data, size, handledFlags);
+        if (format == WireFormat::Compact)
+            locateFields<CompactWireFormat, T>(begin + kCompactHeaderSize, end, begin, spans);
+        else
+            locateFields<LegacyWireFormat, T>(begin, end, begin, spans);
+        return format;
+    }
+
+    // Read an arithmetic field located by locate().
+    template<typename F>
+    static F readScalar(const void* at, WireFormat format)
+    {
+        const char* bytes = static_cast<const char*>(at);
+        if (format == WireFormat::Compact)
+            return CompactWireFormat::readScalar<F>(bytes);
+        return LegacyWireFormat::readScalar<F>(bytes);
+    }
+
+private:
+    static constexpr uint32_t mixHash(uint32_t hash, uint32_t byte)
+    {
+        return (hash ^ byte) * 16777619u;
+    }
+
+    template<typename F>
+    static constexpr uint32_t fieldTag()
+    {
+        if constexpr (std::is_same<F, std::string>::value)
+            return 'S';
+        else
+            return (std::is_floating_point<F>::value ? 'f' : std::is_signed<F>::value ? 'i' : 'u') + (sizeof(F) << 8);
+    }
+
+    template<typename T, size_t... I>
+    static constexpr uint32_t hashFields(uint32_t hash, std::index_sequence<I...>)
+    {
+        ((hash = mixHash(mixHash(hash, fieldTag<MessageFieldType<T, I>>() & 0xFF), fieldTag<MessageFieldType<T, I>>() >> 8)), ...);
+        return hash;
+    }
+
+    template<typename Format, typename T>
+    static size_t fieldsSize(const T& message)
+    {
+        return std::apply([&message](auto... member) {
+            return (size_t{ 0 } + ... + fieldSize<Format>(message.*member));
+        }, MessageSchema<T>::fields);
+    }
+
+    template<typename Format, typename T>
+    static char* encodeFields(const T& message, char* ptr)
+    {
+        std::apply([&](auto... member) {
+            ((ptr = writeField<Format>(ptr, message.*member)), ...);
+        }, MessageSchema<T>::fields);
+        return ptr;
+    }
+
+    template<typename Format, typename T>
+    static void decodeFields(const char* ptr, const char* end, T& message)
+    {
+        std::apply([&](auto... member) {
+            ((ptr = readField<Format>(ptr, end, message.*member)), ...);
+        }, MessageSchema<T>::fields);
+    }
+
+    template<typename Format, typename T>
+    static void locateFields(const char* ptr, const char* end, const char* begin, FieldSpan* spans)
+    {
+        size_t index = 0;
+        std::apply([&](auto... member) {
+            ((ptr = locateField<Format, typename MemberPointerTraits<decltype(member)>::type>(ptr, end, begin, spans[index++])), ...);
+        }, MessageSchema<T>::fields);
+    }
+
+    template<typename Format>
+    static size_t fieldSize(const std::string& value)
+    {
+        return Format::lengthSize(value.size()) + value.size();
+    }
+
+    template<typename Format, typename F>
+    static size_t fieldSize(const F&)
+    {
+        static_assert(std::is_arithmetic<F>::value, "MessageSchema fields must be std::string or arithmetic");
+        return sizeof(F);
+    }
+
+    template<typename Format>
+    static char* writeField(char* ptr, const std::string& value)
+    {
+        ptr = Format::writeLength(ptr, value.size());
+        std::memcpy(ptr, value.data(), value.size());
+        return ptr + value.size();
+    }
+
+    template<typename Format, typename F>
+    static char* writeField(char* ptr, const F& value)
+    {
+        return Format::writeScalar(ptr, value);
+    }
+
+    template<typename Format>
+    static const char* readField(const char* ptr, const char* end, std::string& value)
+    {
+        size_t length;
+        ptr = Format::readLength(ptr, end, length);
+        // compare against the remaining bytes rather than ptr + length so a corrupt
+        // prefix cannot overflow the pointer arithmetic
+        if (length > static_cast<size_t>(end - ptr))
+            throw std::runtime_error("Buffer underflow");
+        value.assign(ptr, length);
+        return ptr + length;
+    }
+
+    template<typename Format, typename F>
+    static const char* readField(const char* ptr, const char* end, F& value)
+    {
+        if (sizeof(F) > static_cast<size_t>(end - ptr))
+            throw std::runtime_error("Buffer underflow");
+        value = Format::template readScalar<F>(ptr);
+        return ptr + sizeof(F);
+    }
+
+    template<typename Format, typename F>
+    static const char* locateField(const char* ptr, const char* end, const char* begin, FieldSpan& span)
+    {
+        size_t length = sizeof(F);
+        if constexpr (std::is_same<F, std::string>::value) {
+            ptr = Format::readLength(ptr, end, length);
+        }
+        if (length > static_cast<size_t>(end - ptr))
+            throw std::runtime_error("Buffer underflow");
+        span.offset = static_cast<size_t>(ptr - begin);
+        span.length = length;
+        return ptr + length;
+    }
+};
+
+// defined after the class so the constexpr schema hashes can be evaluated
+inline MessageTypeId MessageCodec::peekTypeId(const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    if (size < kCompactHeaderSize || static_cast<uint8_t>(bytes[0]) != kCompactVersion)
+        return MessageTypeId::None;
+    uint8_t id = static_cast<uint8_t>(bytes[2]);
+    if (id == 0 || id >= kMessageTypeCount)
+        return MessageTypeId::None;
+    // schema hash of every type, indexed by MessageTypeId
+    static constexpr auto schemaHashes = makeMessageTable<uint32_t>([](auto type) -> uint32_t {
+        using T = typename decltype(type)::type;
+        if constexpr (std::is_same<T, std::monostate>::value)
+            return 0;
+        else
+            return schemaHash<T>();
+    });
+    if (CompactWireFormat::readScalar<uint32_t>(bytes + 3) != schemaHashes[id])
+        return MessageTypeId::None;
+    return static_cast<MessageTypeId>(id);
+}
+
+inline uint8_t MessageCodec::peekFlags(const void* data, size_t size)
+{
+    if (peekTypeId(data, size) == MessageTypeId::None)
+        return 0;
+    return static_cast<uint8_t>(static_cast<const char*>(data)[kCompactFlagsOffset]);
+}
@@ -1,14 +1,42 @@
 #pragma once
+#include <array>
 #include <string>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <variant>
 // Simple file mimicking the layout of UCI structs residing in another file for 
 // each service to use.
+
+// Numeric ID of every payload type. It is carried on the wire (compact format
+// header) and indexes the flat dispatch tables, so values are part of the
+// protocol: append new types before Count, never renumber.
+// A new type also goes into MessageVariant below (at the index of its ID) and
+// gets a MessageSchema entry; the per-type tables are generated from those.
+enum class MessageTypeId : uint8_t
+{
+	None = 0,	// request topics that carry no payload
+	AppStatus = 1,
+	AppDataRequest1 = 2,
+	AppDataRequest2 = 3,
+	Count
+};
+
+constexpr size_t kMessageTypeCount = static_cast<size_t>(MessageTypeId::Count);
+
 struct Message
 {
+	explicit Message(MessageTypeId id = MessageTypeId::None) : typeId(id) {}
 	virtual ~Message() = default;
+
+	MessageTypeId typeId;	// set by each derived type, lets handlers dispatch without RTTI
 };
 
 struct AppStatus : public Message
 {
+	static constexpr MessageTypeId kTypeId = MessageTypeId::AppStatus;
+	AppStatus() : Message(kTypeId) {}
 
 	std::string appId{};
 	std::string appHealth{};
@@ -17,6 +45,8 @@ struct AppStatus : public Message
 
 struct AppDataRequest1 : public Message
 {
+	static constexpr MessageTypeId kTypeId = MessageTypeId::AppDataRequest1;
+	AppDataRequest1() : Message(kTypeId) {}
 
 	std::string appId{};
 	std::string appHealth{};
@@ -26,9 +56,88 @@ struct AppDataRequest1 : public Message
 
 struct AppDataRequest2 : public Message
 {
+	static constexpr MessageTypeId kTypeId = MessageTypeId::AppDataRequest2;
+	AppDataRequest2() : Message(kTypeId) {}
 
 	std::string appId{};
 	std::string appHealth{};
 	float numberToMultiply{ 0.0f };
 
-};
\ No newline at end of file
+};
+
+// Value alternative to the Message hierarchy: a received payload held inline, e.g.
+// in a queue or ring buffer, without a heap allocation per message. Handle it with
+// std::visit. std::monostate stands for request topics that carry no payload.
+// The alternatives are listed in MessageTypeId order, so index() is the type ID.
+using MessageVariant = std::variant<std::monostate, AppStatus, AppDataRequest1, AppDataRequest2>;
+
+static_assert(std::variant_size<MessageVariant>::value == kMessageTypeCount, "MessageVariant must list every MessageTypeId");
+
+template<size_t I>
+constexpr bool messageVariantSlotMatches()
+{
+	using T = std::variant_alternative_t<I, MessageVariant>;
+	if constexpr (I == 0)
+		return std::is_same<T, std::monostate>::value;
+	else
+		return static_cast<size_t>(T::kTypeId) == I;
+}
+
+template<size_t... I>
+constexpr bool messageVariantMatchesTypeIds(std::index_sequence<I...>)
+{
+	return (messageVariantSlotMatches<I>() && ...);
+}
+
+static_assert(messageVariantMatchesTypeIds(std::make_index_sequence<kMessageTypeCount>{}),
+	"MessageVariant alternative I must be the type with kTypeId I");
+
+inline MessageTypeId typeIdOf(const MessageVariant& message)
+{
+	return static_cast<MessageTypeId>(message.index());
+}
+
+// Builds a table indexed by MessageTypeId from the MessageVariant type list, so
+// a type added there shows up in every table without touching them.
+// make(std::type_identity<T>{}) returns the entry of type T; it is called for
+// std::monostate too, which fills slot 0 (MessageTypeId::None).
+template<typename Entry, typename Make, size_t... I>
+constexpr std::array<Entry, sizeof...(I)> makeMessageTable(Make make, std::index_sequence<I...>)
+{
+	return { { make(std::type_identity<std::variant_alternative_t<I, MessageVariant>>{})... } };
+}
+
+template<typename Entry, typename Make>
+constexpr std::array<Entry, kMessageTypeCount> makeMessageTable(Make make)
+{
+	return makeMessageTable<Entry>(make, std::make_index_sequence<kMessageTypeCount>{});
+}
+
+template<size_t I, typename F>
+bool visitMessageAs(const Message& message, F& f)
+{
+	if constexpr (I == 0) {
+		return false; // std::monostate: no struct to visit
+	}
+	else {
+		if (static_cast<size_t>(message.typeId) != I)
+			return false;
+		f(static_cast<const std::variant_alternative_t<I, MessageVariant>&>(message));
+		return true;
+	}
+}
+
+template<typename F, size_t... I>
+bool visitMessage(const Message& message, F& f, std::index_sequence<I...>)
+{
+	return (visitMessageAs<I>(message, f) || ...);
+}
+
+// std::visit for the Message hierarchy: calls f with message as its concrete
+// type, picked by typeId from the MessageVariant type list. Returns false, without
+// calling f, for MessageTypeId::None and IDs this build does not know.
+template<typename F>
+bool visitMessage(const Message& message, F&& f)
+{
+	return visitMessage(message, f, std::make_index_sequence<kMessageTypeCount>{});
+}
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <zmq.hpp>
+#include "Proxy.h"
 
 
 
@@ -15,9 +16,9 @@ int main()
 	void* frontend = zmq_socket(context, ZMQ_XSUB);
 	void* backend = zmq_socket(context, ZMQ_XPUB);
 
-	//bind to ports which will be hard coded to Dummy1, 2, 3
-	zmq_bind(frontend, "tcp://*:5557");
-	zmq_bind(backend, "tcp://*:5558");
+	//bind to ports which will be hard coded to Dummy1, 2, 3, on tcp and (same host) ipc
+	if (!bindProxySockets(frontend, backend, false))
+		return 1;
 
 	//start the proxy, runs until context is closed
 	std::cout << "Proxy Opened" << std::endl;	
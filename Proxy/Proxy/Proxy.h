@@ -1,9 +1,209 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
 #include <string>
+#include <thread>
+#include <zmq.hpp>
 
 //Proxy Frontend / Backend port constants to be used in Dummy Service 1, 2...
 
 extern const std::string PROXYFRONTEND = "tcp://localhost:5557";
 
 extern const std::string PROXYBACKEND = "tcp://localhost:5558";
+
+// How services reach the proxy
+// - Tcp: any host, the original tcp://<host>:5557/5558
+// - Ipc: same host, Unix domain sockets (AF_UNIX; on Windows needs Windows 10 and a libzmq built with ipc)
+// - Inproc: same process, only while this process hosts the proxy (see InProcessProxy)
+// - Auto: the closest of the above that can reach the proxy, see selectProxyTransport()
+enum class ProxyTransport
+{
+    Auto,
+    Tcp,
+    Ipc,
+    Inproc
+};
+
+// Frontend: publishers connect here (proxy XSUB). Backend: subscribers connect here (proxy XPUB).
+struct ProxyEndpoints
+{
+    std::string frontend;
+    std::string backend;
+};
+
+constexpr int PROXYFRONTEND_PORT = 5557;
+constexpr int PROXYBACKEND_PORT = 5558;
+
+// true while an InProcessProxy runs in this process
+inline std::atomic<bool> proxyHostedInProcess{ false };
+
+inline std::string proxyInprocEndpoint(int port)
+{
+    return "inproc://proxy-" + std::to_string(port);
+}
+
+// The socket file lives in the temp directory so every service on the host
+// finds it regardless of its working directory.
+inline std::string proxyIpcEndpoint(int port)
+{
+    std::filesystem::path path = std::filesystem::temp_directory_path() / ("dummyprototype-proxy-" + std::to_string(port));
+    return "ipc://" + path.generic_string();
+}
+
+inline bool proxyIpcSupported()
+{
+    return zmq_has("ipc") != 0;
+}
+
+inline bool isLocalHost(const std::string& host)
+{
+    return host == "localhost" || host == "127.0.0.1" || host == "::1";
+}
+
+// Auto resolves to Inproc when the proxy runs in this process, to Ipc when it
+// runs on this host and libzmq supports ipc, and to Tcp otherwise.
+// Ipc relies on bindProxySockets(): a proxy that cannot bind its ipc endpoints
+// does not start, so a running local proxy always listens on them.
+inline ProxyTransport selectProxyTransport(const std::string& host = "localhost")
+{
+    if (proxyHostedInProcess.load(std::memory_order_acquire))
+        return ProxyTransport::Inproc;
+    if (isLocalHost(host) && proxyIpcSupported())
+        return ProxyTransport::Ipc;
+    return ProxyTransport::Tcp;
+}
+
+// Endpoints a publisher / subscriber connects to.
+// Inproc endpoints only work with the context the proxy was bound on, i.e. ZmqContext::shared().
+inline ProxyEndpoints proxyEndpoints(ProxyTransport transport = ProxyTransport::Auto, const std::string& host = "localhost")
+{
+    if (transport == ProxyTransport::Auto)
+        transport = selectProxyTransport(host);
+
+    switch (transport) {
+    case ProxyTransport::Inproc:
+        return ProxyEndpoints{ proxyInprocEndpoint(PROXYFRONTEND_PORT), proxyInprocEndpoint(PROXYBACKEND_PORT) };
+    case ProxyTransport::Ipc:
+        return ProxyEndpoints{ proxyIpcEndpoint(PROXYFRONTEND_PORT), proxyIpcEndpoint(PROXYBACKEND_PORT) };
+    default:
+        return ProxyEndpoints{ "tcp://" + host + ":" + std::to_string(PROXYFRONTEND_PORT),
+            "tcp://" + host + ":" + std::to_string(PROXYBACKEND_PORT) };
+    }
+}
+
+// Bind the proxy's frontend / backend sockets on every transport a service might
+// pick: tcp for other hosts, ipc for this host and, when hosted in a service,
+// inproc for that service. Returns false if any of them fails: services pick
+// their transport without asking the proxy, so a proxy missing one of them
+// would leave the services that picked it connected to nobody.
+inline bool bindProxySockets(void* frontend, void* backend, bool inproc)
+{
+    if (zmq_bind(frontend, ("tcp://*:" + std::to_string(PROXYFRONTEND_PORT)).c_str()) != 0
+        || zmq_bind(backend, ("tcp://*:" + std::to_string(PROXYBACKEND_PORT)).c_str()) != 0) {
+        std::cerr << "Proxy tcp bind error: " << zmq_strerror(zmq_errno()) << "\n";
+        return false;
+    }
+
+    if (proxyIpcSupported()) {
+        // a stale socket file from a crashed proxy would make the bind fail
+        std::error_code ec;
+        std::filesystem::remove(proxyIpcEndpoint(PROXYFRONTEND_PORT).substr(6), ec);
+        std::filesystem::remove(proxyIpcEndpoint(PROXYBACKEND_PORT).substr(6), ec);
+        if (zmq_bind(frontend, proxyIpcEndpoint(PROXYFRONTEND_PORT).c_str()) != 0
+            || zmq_bind(backend, proxyIpcEndpoint(PROXYBACKEND_PORT).c_str()) != 0) {
+            // local services select ipc on their own (see selectProxyTransport), so
+            // running without it would silently cut them off
+            std::cerr << "Proxy ipc bind error: " << zmq_strerror(zmq_errno()) << "\n";
+            return false;
+        }
+    }
+
+    if (inproc) {
+        if (zmq_bind(frontend, proxyInprocEndpoint(PROXYFRONTEND_PORT).c_str()) != 0
+            || zmq_bind(backend, proxyInprocEndpoint(PROXYBACKEND_PORT).c_str()) != 0) {
+            std::cerr << "Proxy inproc bind error: " << zmq_strerror(zmq_errno()) << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Runs the proxy on a background thread of a service, so services hosted in
+// the same process talk over inproc while other processes still reach it over
+// ipc / tcp. Pass the context the service's sockets use (ZmqContext::shared()),
+// inproc endpoints are per context.
+// Start it before creating publishers / subscribers so Auto selects Inproc.
+class InProcessProxy
+{
+public:
+    explicit InProcessProxy(zmq::context_t& context) : context_(context) {}
+
+    ~InProcessProxy() { stop(); }
+
+    InProcessProxy(const InProcessProxy&) = delete;
+    InProcessProxy& operator=(const InProcessProxy&) = delete;
+
+    bool start()
+    {
+        if (thread_.joinable())
+            return true;
+
+        try {
+            frontend_ = zmq::socket_t(context_, zmq::socket_type::xsub);
+            backend_ = zmq::socket_t(context_, zmq::socket_type::xpub);
+            control_ = zmq::socket_t(context_, zmq::socket_type::pair);
+            frontend_.set(zmq::sockopt::linger, 0);
+            backend_.set(zmq::sockopt::linger, 0);
+            control_.bind(controlEndpoint());
+            stopper_ = zmq::socket_t(context_, zmq::socket_type::pair);
+            stopper_.connect(controlEndpoint());
+        }
+        catch (const zmq::error_t& e) {
+            std::cerr << "InProcessProxy start error: " << e.what() << "\n";
+            return false;
+        }
+        if (!bindProxySockets(frontend_.handle(), backend_.handle(), true))
+            return false;
+
+        proxyHostedInProcess.store(true, std::memory_order_release);
+        thread_ = std::thread([this]() {
+            // returns once stop() sends TERMINATE on the control socket
+            zmq_proxy_steerable(frontend_.handle(), backend_.handle(), nullptr, control_.handle());
+        });
+        return true;
+    }
+
+    void stop()
+    {
+        if (!thread_.joinable())
+            return;
+        try {
+            stopper_.send(zmq::str_buffer("TERMINATE"), zmq::send_flags::none);
+        }
+        catch (const zmq::error_t& e) {
+            std::cerr << "InProcessProxy stop error: " << e.what() << "\n";
+        }
+        thread_.join();
+        proxyHostedInProcess.store(false, std::memory_order_release);
+        stopper_.close();
+        control_.close();
+        frontend_.close();
+        backend_.close();
+    }
+
+private:
+    std::string controlEndpoint() const
+    {
+        return "inproc://proxy-control-" + std::to_string(reinterpret_cast<uintptr_t>(this));
+    }
+
+    zmq::context_t& context_;
+    zmq::socket_t frontend_;
+    zmq::socket_t backend_;
+    zmq::socket_t control_;
+    zmq::socket_t stopper_;
+    std::thread thread_;
+};
@@ -0,0 +1,123 @@
+// CRC32C checksum for ZeroMQ payload frames (see Crc32c.h).
+
+#include "Crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CRC32C_HAVE_SSE42 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CRC32C_TARGET_SSE42
+#else
+#include <cpuid.h>
+#define CRC32C_TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace
+{
+    constexpr uint32_t kPolynomial = 0x82F63B78u; // Castagnoli, bit reversed
+
+    // kTables[0] is the classic byte table; kTables[k][n] is the CRC of byte n
+    // followed by k zero bytes, which lets the fallback fold 8 bytes per step.
+    constexpr std::array<std::array<uint32_t, 256>, 8> makeTables()
+    {
+        std::array<std::array<uint32_t, 256>, 8> tables{};
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t crc = n;
+            for (int bit = 0; bit < 8; ++bit)
+                crc = (crc >> 1) ^ ((crc & 1u) ? kPolynomial : 0u);
+            tables[0][n] = crc;
+        }
+        for (uint32_t n = 0; n < 256; ++n)
+            for (size_t k = 1; k < 8; ++k)
+                tables[k][n] = (tables[k - 1][n] >> 8) ^ tables[0][tables[k - 1][n] & 0xFF];
+        return tables;
+    }
+
+    constexpr auto kTables = makeTables();
+
+    // state is the running (inverted) CRC register
+    uint32_t updateSoftware(uint32_t state, const uint8_t* p, size_t size)
+    {
+        while (size >= 8) {
+            uint32_t low;
+            uint32_t high;
+            std::memcpy(&low, p, 4);
+            std::memcpy(&high, p + 4, 4);
+            // the tables assume little-endian loads, which holds for every target we build
+            low ^= state;
+            state = kTables[7][low & 0xFF] ^ kTables[6][(low >> 8) & 0xFF] ^
+                kTables[5][(low >> 16) & 0xFF] ^ kTables[4][low >> 24] ^
+                kTables[3][high & 0xFF] ^ kTables[2][(high >> 8) & 0xFF] ^
+                kTables[1][(high >> 16) & 0xFF] ^ kTables[0][high >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while (size--)
+            state = (state >> 8) ^ kTables[0][(state ^ *p++) & 0xFF];
+        return state;
+    }
+
+#ifdef CRC32C_HAVE_SSE42
+    CRC32C_TARGET_SSE42 uint32_t updateHardware(uint32_t state, const uint8_t* p, size_t size)
+    {
+        uint64_t state64 = state;
+        while (size >= 8) {
+            uint64_t word;
+            std::memcpy(&word, p, 8);
+            state64 = _mm_crc32_u64(state64, word);
+            p += 8;
+            size -= 8;
+        }
+        state = static_cast<uint32_t>(state64);
+        while (size--)
+            state = _mm_crc32_u8(state, *p++);
+        return state;
+    }
+
+    bool cpuHasSse42()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        unsigned eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+            return false;
+        return (ecx & bit_SSE4_2) != 0;
+#endif
+    }
+#endif
+
+    using UpdateFn = uint32_t(*)(uint32_t, const uint8_t*, size_t);
+
+    UpdateFn selectUpdate()
+    {
+#ifdef CRC32C_HAVE_SSE42
+        if (cpuHasSse42())
+            return &updateHardware;
+#endif
+        return &updateSoftware;
+    }
+
+    const UpdateFn kUpdate = selectUpdate();
+}
+
+uint32_t Crc32c::compute(const void* data, size_t size, uint32_t crc)
+{
+    return ~kUpdate(~crc, static_cast<const uint8_t*>(data), size);
+}
+
+bool Crc32c::hardwareAccelerated()
+{
+#ifdef CRC32C_HAVE_SSE42
+    return kUpdate == &updateHardware;
+#else
+    return false;
+#endif
+}
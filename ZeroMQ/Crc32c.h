@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC32C (Castagnoli) used as the optional integrity trailer on payload frames.
+// On x86-64 CPUs with SSE4.2 the crc32 instruction is used (8 bytes per step);
+// everywhere else a slicing-by-8 table implementation. The choice is made once,
+// at startup, from the CPUID feature bits.
+class Crc32c
+{
+public:
+    // CRC32C of size bytes at data. Pass a previous result as crc to extend it
+    // over a following buffer: compute(b, nb, compute(a, na)) == compute(a + b).
+    static uint32_t compute(const void* data, size_t size, uint32_t crc = 0);
+
+    // True if compute() runs on the SSE4.2 crc32 instruction.
+    static bool hardwareAccelerated();
+};
@@ -0,0 +1,180 @@
+// LZ77 block compressor used for large ZeroMQ payloads (see LzCompressor.h).
+
+#include "LzCompressor.h"
+
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kMinMatch = 4;
+    constexpr size_t kLastLiterals = 5;     // the block always ends with literals
+    constexpr size_t kMatchStartLimit = 12; // no match may start this close to the end
+    constexpr size_t kMaxOffset = 65535;
+    constexpr unsigned kHashBits = 12;
+
+    uint32_t read32(const uint8_t* p)
+    {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash32(uint32_t sequence)
+    {
+        return (sequence * 2654435761u) >> (32 - kHashBits);
+    }
+
+    // Writes the 255-run extension of a length that did not fit in the token nibble.
+    uint8_t* writeLength(uint8_t* op, size_t length)
+    {
+        while (length >= 255) {
+            *op++ = 255;
+            length -= 255;
+        }
+        *op++ = static_cast<uint8_t>(length);
+        return op;
+    }
+
+    // Reads a 255-run extension. Returns false if the input ends first.
+    bool readLength(const uint8_t*& ip, const uint8_t* iend, size_t& length)
+    {
+        uint8_t byte;
+        do {
+            if (ip >= iend)
+                return false;
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Emits one sequence; matchLength == 0 marks the final literals-only sequence.
+    // Returns nullptr when the output buffer is too small.
+    uint8_t* writeSequence(uint8_t* op, uint8_t* oend, const uint8_t* literals, size_t literalLength,
+        size_t offset, size_t matchLength)
+    {
+        size_t needed = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+        if (needed > static_cast<size_t>(oend - op))
+            return nullptr;
+
+        uint8_t* token = op++;
+        *token = static_cast<uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+        if (literalLength >= 15)
+            op = writeLength(op, literalLength - 15);
+        std::memcpy(op, literals, literalLength);
+        op += literalLength;
+
+        if (matchLength == 0)
+            return op;
+
+        *op++ = static_cast<uint8_t>(offset);
+        *op++ = static_cast<uint8_t>(offset >> 8);
+        size_t code = matchLength - kMinMatch;
+        *token |= static_cast<uint8_t>(code < 15 ? code : 15);
+        if (code >= 15)
+            op = writeLength(op, code - 15);
+        return op;
+    }
+}
+
+size_t LzCompressor::maxCompressedSize(size_t inputSize)
+{
+    return inputSize + inputSize / 255 + 16;
+}
+
+size_t LzCompressor::compress(const void* in, size_t inSize, void* out, size_t outCapacity)
+{
+    const uint8_t* base = static_cast<const uint8_t*>(in);
+    const uint8_t* iend = base + inSize;
+    const uint8_t* anchor = base;
+    uint8_t* ostart = static_cast<uint8_t*>(out);
+    uint8_t* op = ostart;
+    uint8_t* oend = ostart + outCapacity;
+
+    if (inSize > kMatchStartLimit) {
+        // positions of recently seen 4 byte sequences, relative to base
+        uint32_t table[1u << kHashBits] = {};
+        const uint8_t* matchLimit = iend - kLastLiterals;
+        const uint8_t* ip = base;
+
+        while (ip < iend - kMatchStartLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t h = hash32(sequence);
+            const uint8_t* ref = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+
+            if (ref >= ip || static_cast<size_t>(ip - ref) > kMaxOffset || read32(ref) != sequence) {
+                ++ip;
+                continue;
+            }
+
+            size_t matchLength = kMinMatch;
+            while (ip + matchLength < matchLimit && ip[matchLength] == ref[matchLength])
+                ++matchLength;
+
+            op = writeSequence(op, oend, anchor, static_cast<size_t>(ip - anchor),
+                static_cast<size_t>(ip - ref), matchLength);
+            if (!op)
+                return 0;
+            ip += matchLength;
+            anchor = ip;
+        }
+    }
+
+    op = writeSequence(op, oend, anchor, static_cast<size_t>(iend - anchor), 0, 0);
+    if (!op)
+        return 0;
+    return static_cast<size_t>(op - ostart);
+}
+
+bool LzCompressor::decompress(const void* in, size_t inSize, void* out, size_t outSize)
+{
+    const uint8_t* ip = static_cast<const uint8_t*>(in);
+    const uint8_t* iend = ip + inSize;
+    uint8_t* ostart = static_cast<uint8_t*>(out);
+    uint8_t* op = ostart;
+    uint8_t* oend = ostart + outSize;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(ip, iend, literalLength))
+            return false;
+        if (literalLength > static_cast<size_t>(iend - ip) || literalLength > static_cast<size_t>(oend - op))
+            return false;
+        std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // the last sequence carries literals only
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - ostart))
+            return false;
+
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(ip, iend, matchLength))
+            return false;
+        matchLength += kMinMatch;
+        if (matchLength > static_cast<size_t>(oend - op))
+            return false;
+
+        const uint8_t* match = op - offset;
+        if (offset >= matchLength) {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else {
+            // overlapping copy repeats the last 'offset' bytes
+            for (size_t i = 0; i < matchLength; ++i)
+                *op++ = match[i];
+        }
+    }
+    return op == oend;
+}
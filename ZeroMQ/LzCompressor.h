@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Small dependency-free LZ77 block compressor for large message payloads.
+// The block layout follows the LZ4 block format: sequences of
+// [token][extra literal length][literals][2 byte LE offset][extra match length],
+// with a 4 byte minimum match and a 64 KiB window. It favours speed over ratio,
+// which is the right trade for a hop through the proxy on every message.
+// Both functions work on caller-provided buffers and never allocate.
+class LzCompressor
+{
+public:
+    // Worst case output size for inputSize bytes of incompressible data.
+    static size_t maxCompressedSize(size_t inputSize);
+
+    // Compress inSize bytes into out. Returns the compressed size, or 0 if the
+    // result does not fit in outCapacity.
+    static size_t compress(const void* in, size_t inSize, void* out, size_t outCapacity);
+
+    // Decompress a block produced by compress(). Returns true only if the block is
+    // well formed and expands to exactly outSize bytes; malformed input never reads
+    // or writes outside the given buffers.
+    static bool decompress(const void* in, size_t inSize, void* out, size_t outSize);
+};
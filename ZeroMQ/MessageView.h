@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include "MessageSchema.h"
+
+#define ZMQ_BUILD_DRAFT_API
+#include <zmq.hpp>
+
+// Read-only view over a received payload frame.
+// The view owns the zmq::message_t and hands out std::string_view / scalar
+// accessors that point straight into the frame bytes, so a message can go from
+// the socket to a handler without allocating or copying. The frame is walked
+// once on construction (MessageCodec::locate) to find every field; both the
+// legacy and the compact wire format are understood. The payload may start at an
+// offset inside the frame (single-frame envelopes carry the topic in front of it).
+// Views stay valid for as long as they are alive; string_views obtained from a
+// view must not outlive it.
+template<typename T>
+class MessageView
+{
+public:
+    // Takes ownership of the frame; the payload starts offset bytes in.
+    // handledFlags are the header flags the receiver has already dealt with (e.g. a
+    // verified checksum); the frame itself is never modified, it may be shared.
+    // Throws std::runtime_error("Buffer underflow") if the payload is too short for T.
+    explicit MessageView(zmq::message_t&& frame, size_t offset = 0, uint8_t handledFlags = 0)
+        : frame_(std::move(frame)), offset_(offset), handledFlags_(handledFlags)
+    {
+        format_ = MessageCodec::locate<T>(payload(), payloadSize(), spans_.data(), handledFlags_);
+    }
+
+    // Access a field by member pointer, e.g. view.get<&AppStatus::appId>().
+    // std::string members come back as std::string_view, arithmetic members by value.
+    template<auto Member>
+    auto get() const
+    {
+        constexpr size_t index = indexOf<Member>();
+        using Field = MessageFieldType<T, index>;
+        const char* at = payload() + spans_[index].offset;
+        if constexpr (std::is_same<Field, std::string>::value)
+            return std::string_view(at, spans_[index].length);
+        else
+            return MessageCodec::readScalar<Field>(at, format_);
+    }
+
+    // Copy the view into an owning struct when the handler needs to keep the data.
+    T materialize() const
+    {
+        return MessageCodec::decode<T>(payload(), payloadSize(), handledFlags_);
+    }
+
+    const zmq::message_t& frame() const { return frame_; }
+
+private:
+    const char* payload() const { return static_cast<const char*>(frame_.data()) + offset_; }
+    size_t payloadSize() const { return frame_.size() - offset_; }
+
+    // position of Member inside MessageSchema<T>::fields, resolved at compile time
+    template<auto Member, size_t I = 0>
+    static constexpr size_t indexOf()
+    {
+        static_assert(I < MessageFieldCount<T>, "member is not described in MessageSchema<T>");
+        constexpr auto candidate = std::get<I>(MessageSchema<T>::fields);
+        if constexpr (std::is_same<std::remove_const_t<decltype(candidate)>, decltype(Member)>::value) {
+            if constexpr (candidate == Member)
+                return I;
+            else
+                return indexOf<Member, I + 1>();
+        }
+        else {
+            return indexOf<Member, I + 1>();
+        }
+    }
+
+    zmq::message_t frame_;
+    size_t offset_;
+    uint8_t handledFlags_;
+    std::array<MessageCodec::FieldSpan, MessageFieldCount<T>> spans_{};
+    WireFormat format_ = WireFormat::Legacy;
+};
+
+// Named views for the structs in Messages.h
+
+class AppStatusView : public MessageView<AppStatus>
+{
+public:
+    using MessageView::MessageView;
+    std::string_view appId() const { return get<&AppStatus::appId>(); }
+    std::string_view appHealth() const { return get<&AppStatus::appHealth>(); }
+    double appRuntime() const { return get<&AppStatus::appRuntime>(); }
+};
+
+class AppDataRequest1View : public MessageView<AppDataRequest1>
+{
+public:
+    using MessageView::MessageView;
+    std::string_view appId() const { return get<&AppDataRequest1::appId>(); }
+    std::string_view appHealth() const { return get<&AppDataRequest1::appHealth>(); }
+    uint32_t numberToAdd() const { return get<&AppDataRequest1::numberToAdd>(); }
+};
+
+class AppDataRequest2View : public MessageView<AppDataRequest2>
+{
+public:
+    using MessageView::MessageView;
+    std::string_view appId() const { return get<&AppDataRequest2::appId>(); }
+    std::string_view appHealth() const { return get<&AppDataRequest2::appHealth>(); }
+    float numberToMultiply() const { return get<&AppDataRequest2::numberToMultiply>(); }
+};
+
+// The view a subscriber hands out for T: the named view above if T has one,
+// otherwise the generic MessageView<T> (fields through get<&T::member>()).
+template<typename T>
+struct MessageViewFor
+{
+    using type = MessageView<T>;
+};
+
+template<>
+struct MessageViewFor<AppStatus>
+{
+    using type = AppStatusView;
+};
+
+template<>
+struct MessageViewFor<AppDataRequest1>
+{
+    using type = AppDataRequest1View;
+};
+
+template<>
+struct MessageViewFor<AppDataRequest2>
+{
+    using type = AppDataRequest2View;
+};
+
+template<typename Variant>
+struct MessageViewVariantOf;
+
+template<typename... T>
+struct MessageViewVariantOf<std::variant<std::monostate, T...>>
+{
+    using type = std::variant<std::monostate, typename MessageViewFor<T>::type...>;
+};
+
+// What a view callback receives: std::monostate for request topics that carry
+// no payload, otherwise the view matching the response topic. Generated from
+// MessageVariant, so index() is the type ID here too.
+using MessageViewVariant = MessageViewVariantOf<MessageVariant>::type;
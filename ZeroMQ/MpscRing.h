@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free multi-producer / single-consumer ring.
+// Each slot carries a sequence number (Vyukov's bounded queue): a producer claims
+// a slot with one CAS on the tail, fills it and publishes it by bumping the slot's
+// sequence; the consumer reads slots in order and hands them back the same way.
+// Producers never wait on each other beyond that CAS and never wait on the
+// consumer: a full ring makes tryPush() fail instead of blocking.
+// T must be default constructible and move assignable.
+template<typename T>
+class MpscRing
+{
+public:
+    // capacity is rounded up to a power of two
+    explicit MpscRing(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        mask_ = size - 1;
+        slots_ = std::make_unique<Slot[]>(size);
+        for (size_t i = 0; i < size; ++i)
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    // Any thread. Moves value in and returns true, or returns false (value
+    // untouched) if the ring is full.
+    bool tryPush(T&& value)
+    {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & mask_];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == pos) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (sequence < pos) {
+                return false; // the consumer has not freed this slot yet: full
+            }
+            else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        Slot& slot = slots_[pos & mask_];
+        slot.value = std::move(value);
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. Moves the oldest value out, or returns false if empty.
+    bool tryPop(T& value)
+    {
+        Slot& slot = slots_[head_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1)
+            return false;
+        value = std::move(slot.value);
+        slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        ++head_;
+        return true;
+    }
+
+    // Consumer thread only.
+    bool empty() const
+    {
+        return slots_[head_ & mask_].sequence.load(std::memory_order_acquire) != head_ + 1;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence{ 0 };
+        T value{};
+    };
+
+    // producers and the consumer write different cache lines
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    alignas(64) size_t head_ = 0;
+    size_t mask_ = 0;
+    std::unique_ptr<Slot[]> slots_;
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#define ZMQ_BUILD_DRAFT_API
+#include <zmq.hpp>
+
+struct SendBufferPoolStats
+{
+    uint64_t hits;   // buffers served from a free list
+    uint64_t misses; // buffers that had to be allocated (including oversized ones)
+    size_t idle;     // buffers currently waiting for reuse, over all size classes
+                     // (not counting the few held in per-thread caches)
+};
+
+// Process-wide pool of payload buffers for outgoing frames.
+// makeMessage() hands a pooled buffer to zmq::message_t through its zero-copy
+// constructor; libzmq calls release() once the frame has been written out, which
+// returns the buffer to its size class. The publisher encodes straight into the
+// buffer, so a payload is neither copied nor allocated once the pool has warmed up.
+// Payloads small enough for libzmq to store inside the zmq::message_t itself skip
+// the pool, they never allocate to begin with.
+// Note that libzmq still allocates its small reference-count block for every
+// zero-copy message; that allocation is internal to libzmq and cannot be avoided
+// through the public API.
+// A publishing thread takes kRefill buffers from the shared free list at a time
+// and hands them out from its own cache, so concurrent publishers meet on the
+// pool's lock once per kRefill messages rather than on every one. Buffers come
+// back through the shared list, because libzmq releases them on its own threads.
+// The pool is never destroyed, because libzmq may release buffers from its I/O
+// threads while static destructors run. acquire and release are thread-safe.
+class SendBufferPool
+{
+public:
+    // largest payload libzmq keeps inline in a zmq::message_t (64-bit builds)
+    static constexpr size_t kInlineSize = 33;
+
+    static SendBufferPool& shared()
+    {
+        static SendBufferPool* pool = new SendBufferPool(); // intentionally leaked, see above
+        return *pool;
+    }
+
+    // A zmq::message_t of exactly size bytes backed by a pooled buffer.
+    zmq::message_t makeMessage(size_t size)
+    {
+        if (size <= kInlineSize)
+            return zmq::message_t(size);
+        size_t sizeClass = classFor(size);
+        void* buffer = acquire(sizeClass, size);
+        return zmq::message_t(buffer, size, &SendBufferPool::release, reinterpret_cast<void*>(sizeClass));
+    }
+
+    // Upper bound on idle buffers kept per size class; extra releases are freed.
+    void setMaxIdle(size_t maxIdle)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        maxIdle_ = maxIdle;
+        for (std::vector<void*>& idle : idle_) {
+            while (idle.size() > maxIdle_) {
+                ::operator delete(idle.back());
+                idle.pop_back();
+            }
+            idle.reserve(maxIdle_);
+        }
+    }
+
+    SendBufferPoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t idle = 0;
+        for (const std::vector<void*>& list : idle_)
+            idle += list.size();
+        return SendBufferPoolStats{ hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed), idle };
+    }
+
+private:
+    // power of two size classes from 64 bytes to 64 KiB; bigger buffers are not pooled
+    static constexpr size_t kMinClassShift = 6;
+    static constexpr size_t kClassCount = 11;
+    static constexpr size_t kUnpooled = kClassCount;
+    // buffers moved from the shared free list to a thread's cache at once
+    static constexpr size_t kRefill = 8;
+
+    // the buffers a thread took from the shared list but has not used yet; they
+    // go back to the pool when the thread exits
+    struct ThreadCache
+    {
+        std::array<std::vector<void*>, kClassCount> buffers;
+
+        ~ThreadCache()
+        {
+            for (size_t sizeClass = 0; sizeClass < kClassCount; ++sizeClass) {
+                for (void* buffer : buffers[sizeClass])
+                    release(buffer, reinterpret_cast<void*>(sizeClass));
+            }
+        }
+    };
+
+    static ThreadCache& threadCache()
+    {
+        thread_local ThreadCache cache;
+        return cache;
+    }
+
+    SendBufferPool()
+    {
+        for (std::vector<void*>& idle : idle_)
+            idle.reserve(maxIdle_);
+    }
+
+    SendBufferPool(const SendBufferPool&) = delete;
+    SendBufferPool& operator=(const SendBufferPool&) = delete;
+
+    static size_t classFor(size_t size)
+    {
+        size_t sizeClass = 0;
+        while (sizeClass < kClassCount && (size_t(1) << (sizeClass + kMinClassShift)) < size)
+            ++sizeClass;
+        return sizeClass;
+    }
+
+    void* acquire(size_t sizeClass, size_t size)
+    {
+        if (sizeClass != kUnpooled) {
+            std::vector<void*>& cached = threadCache().buffers[sizeClass];
+            if (cached.empty()) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::vector<void*>& idle = idle_[sizeClass];
+                size_t take = idle.size() < kRefill ? idle.size() : kRefill;
+                cached.insert(cached.end(), idle.end() - take, idle.end());
+                idle.resize(idle.size() - take);
+            }
+            if (!cached.empty()) {
+                void* buffer = cached.back();
+                cached.pop_back();
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                return buffer;
+            }
+            size = size_t(1) << (sizeClass + kMinClassShift);
+        }
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    // zmq::free_fn: called by libzmq (possibly on one of its I/O threads)
+    static void release(void* data, void* hint)
+    {
+        size_t sizeClass = reinterpret_cast<size_t>(hint);
+        if (sizeClass != kUnpooled) {
+            SendBufferPool& pool = shared();
+            std::lock_guard<std::mutex> lock(pool.mutex_);
+            std::vector<void*>& idle = pool.idle_[sizeClass];
+            if (idle.size() < pool.maxIdle_) {
+                idle.push_back(data);
+                return;
+            }
+        }
+        ::operator delete(data);
+    }
+
+    std::mutex mutex_;
+    std::array<std::vector<void*>, kClassCount> idle_;
+    size_t maxIdle_ = 64;
+    std::atomic<uint64_t> hits_{ 0 };
+    std::atomic<uint64_t> misses_{ 0 };
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct ShardStats
+{
+    size_t depth;      // tasks queued on the shard right now
+    size_t maxDepth;   // deepest the queue has been
+    uint64_t executed; // tasks the shard has run
+};
+
+// Fixed set of shard threads, each draining its own FIFO queue.
+// submit() picks the shard from a key hash, so tasks with the same key always
+// run on the same thread in submission order, while different keys spread over
+// the shards and run in parallel. Unlike WorkStealingExecutor nothing moves
+// between shards: that is what keeps the per-key order.
+// Tasks are values of T handed to one handler; T only needs to be move constructible.
+template<typename T>
+class ShardedDispatcher
+{
+public:
+    using Handler = std::function<void(T&)>;
+
+    // shards == 0 uses one shard per hardware thread
+    ShardedDispatcher(size_t shards, Handler handler)
+        : handler_(std::move(handler))
+    {
+        if (shards == 0)
+            shards = std::thread::hardware_concurrency();
+        if (shards == 0)
+            shards = 1; // hardware_concurrency() may not know
+        shards_.reserve(shards);
+        for (size_t i = 0; i < shards; ++i)
+            shards_.push_back(std::make_unique<Shard>());
+        for (size_t i = 0; i < shards; ++i)
+            shards_[i]->thread = std::thread(&ShardedDispatcher::shardLoop, this, std::ref(*shards_[i]));
+    }
+
+    // Runs the tasks still queued, then joins the shard threads.
+    ~ShardedDispatcher()
+    {
+        for (std::unique_ptr<Shard>& shard : shards_) {
+            {
+                std::lock_guard<std::mutex> lock(shard->mutex);
+                shard->stopping = true;
+            }
+            shard->wake.notify_one();
+        }
+        for (std::unique_ptr<Shard>& shard : shards_)
+            shard->thread.join();
+    }
+
+    ShardedDispatcher(const ShardedDispatcher&) = delete;
+    ShardedDispatcher& operator=(const ShardedDispatcher&) = delete;
+
+    // Any thread; tasks submitted from one thread with equal keys run in that order.
+    void submit(uint64_t key, T&& task)
+    {
+        Shard& shard = *shards_[key % shards_.size()];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.tasks.push_back(std::move(task));
+            if (shard.tasks.size() > shard.maxDepth)
+                shard.maxDepth = shard.tasks.size();
+        }
+        shard.wake.notify_one();
+    }
+
+    // Blocks until every shard has run everything submitted so far.
+    void waitIdle()
+    {
+        for (std::unique_ptr<Shard>& shard : shards_) {
+            std::unique_lock<std::mutex> lock(shard->mutex);
+            shard->idle.wait(lock, [&]() { return shard->tasks.empty() && !shard->busy; });
+        }
+    }
+
+    size_t shardCount() const { return shards_.size(); }
+
+    std::vector<ShardStats> stats() const
+    {
+        std::vector<ShardStats> result;
+        result.reserve(shards_.size());
+        for (const std::unique_ptr<Shard>& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            result.push_back(ShardStats{ shard->tasks.size(), shard->maxDepth, shard->executed });
+        }
+        return result;
+    }
+
+private:
+    // one per shard thread, on its own cache lines so shards do not contend
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::deque<T> tasks;
+        size_t maxDepth = 0;
+        uint64_t executed = 0;
+        bool busy = false;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    void shardLoop(Shard& shard)
+    {
+        std::optional<T> task;
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        for (;;) {
+            shard.wake.wait(lock, [&]() { return !shard.tasks.empty() || shard.stopping; });
+            if (shard.tasks.empty())
+                return; // stopping and drained
+
+            task.emplace(std::move(shard.tasks.front()));
+            shard.tasks.pop_front();
+            shard.busy = true;
+            lock.unlock();
+            handler_(*task);
+            task.reset(); // release the payload before taking the lock again
+            lock.lock();
+            shard.busy = false;
+            ++shard.executed;
+            if (shard.tasks.empty())
+                shard.idle.notify_all();
+        }
+    }
+
+    Handler handler_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Messages.h"
+
+// What a topic means to a subscriber.
+// A Request topic carries no payload: some service asks for data and we answer
+// on replyTopic with a typeId payload. A Response topic carries a typeId payload.
+enum class TopicKind : uint8_t
+{
+    Unknown = 0,
+    Request,
+    Response
+};
+
+struct TopicRoute
+{
+    std::string topic;
+    TopicKind kind = TopicKind::Unknown;
+    MessageTypeId typeId = MessageTypeId::None; // payload type on the topic (Response) or of the reply (Request)
+    std::string replyTopic;                     // Request topics: where the answer is published
+    int handler = -1;                           // index of the subscriber's subscribe<T>() route, -1 for none
+};
+
+// Topic -> TopicRoute table, built once and read-only afterwards.
+// Open addressing with linear probing over a power-of-two slot array kept at
+// most half full, keyed by the FNV-1a hash of the topic: classifying a received
+// topic is one hash over its bytes, usually one probe and one compare, and
+// never builds a temporary string.
+class TopicRegistry
+{
+public:
+    // Add or replace the route for route.topic. Takes effect with the next build().
+    void add(TopicRoute route)
+    {
+        for (TopicRoute& existing : routes_) {
+            if (existing.topic == route.topic) {
+                existing = std::move(route);
+                return;
+            }
+        }
+        routes_.push_back(std::move(route));
+    }
+
+    // Lay out the hash table. find() must not run concurrently with add() / build().
+    void build()
+    {
+        size_t size = 8;
+        while (size < routes_.size() * 2)
+            size <<= 1;
+        mask_ = size - 1;
+        slots_.assign(size, Slot{});
+        for (size_t i = 0; i < routes_.size(); ++i) {
+            uint64_t hash = hashOf(routes_[i].topic);
+            size_t pos = static_cast<size_t>(hash) & mask_;
+            while (slots_[pos].index >= 0)
+                pos = (pos + 1) & mask_;
+            slots_[pos] = Slot{ hash, static_cast<int>(i) };
+        }
+    }
+
+    // The route for topic, or nullptr if the topic is not registered.
+    const TopicRoute* find(std::string_view topic) const
+    {
+        if (slots_.empty())
+            return nullptr;
+        uint64_t hash = hashOf(topic);
+        for (size_t pos = static_cast<size_t>(hash) & mask_;; pos = (pos + 1) & mask_) {
+            const Slot& slot = slots_[pos];
+            if (slot.index < 0)
+                return nullptr;
+            if (slot.hash == hash && routes_[slot.index].topic == topic)
+                return &routes_[slot.index];
+        }
+    }
+
+    const std::vector<TopicRoute>& routes() const { return routes_; }
+
+    // The request / response topics the Dummy services exchange:
+    // <kind>RequestFrom<n> asks the other services for data, the answer comes
+    // back on <kind>ResponseTo<n>.
+    static TopicRegistry serviceTopics()
+    {
+        struct Kind
+        {
+            const char* request;
+            const char* response;
+            MessageTypeId typeId;
+        };
+        static const Kind kinds[] = {
+            { "statusRequestFrom", "statusResponseTo", MessageTypeId::AppStatus },
+            { "additionRequestFrom", "additionResponseTo", MessageTypeId::AppDataRequest1 },
+            { "multiplicationRequestFrom", "multiplicationResponseTo", MessageTypeId::AppDataRequest2 },
+        };
+
+        TopicRegistry registry;
+        for (const Kind& kind : kinds) {
+            for (char service = '1'; service <= '3'; ++service) {
+                registry.add(TopicRoute{ kind.request + std::string(1, service), TopicKind::Request, kind.typeId,
+                    kind.response + std::string(1, service) });
+                registry.add(TopicRoute{ kind.response + std::string(1, service), TopicKind::Response, kind.typeId, {} });
+            }
+        }
+        registry.build();
+        return registry;
+    }
+
+private:
+    struct Slot
+    {
+        uint64_t hash = 0;
+        int index = -1; // into routes_, -1 for an empty slot
+    };
+
+    static uint64_t hashOf(std::string_view topic)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : topic) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::vector<TopicRoute> routes_;
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+};
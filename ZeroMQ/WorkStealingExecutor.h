@@ -0,0 +1,179 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct WorkStealingStats
+{
+    uint64_t executed; // tasks run, over all workers
+    uint64_t stolen;   // of those, tasks a worker took from another worker's deque
+};
+
+// Fixed pool of worker threads, each with its own task deque.
+// submit() deals tasks round-robin onto the deques; a worker runs its own tasks
+// oldest first and, once its deque is empty, steals the newest task of another
+// worker, so one slow task only holds up the tasks behind it on the same deque
+// until the other workers come looking.
+// Tasks are values of T handed to one handler, which keeps submit() free of type
+// erasure; T only needs to be move constructible. Idle workers sleep on a
+// condition variable, the submitting thread only signals when one is asleep.
+template<typename T>
+class WorkStealingExecutor
+{
+public:
+    using Handler = std::function<void(T&)>;
+
+    // workers == 0 uses one worker per hardware thread
+    WorkStealingExecutor(size_t workers, Handler handler)
+        : handler_(std::move(handler))
+    {
+        if (workers == 0)
+            workers = std::thread::hardware_concurrency();
+        if (workers == 0)
+            workers = 1; // hardware_concurrency() may not know
+        queues_.reserve(workers);
+        for (size_t i = 0; i < workers; ++i)
+            queues_.push_back(std::make_unique<WorkerQueue>());
+        threads_.reserve(workers);
+        for (size_t i = 0; i < workers; ++i)
+            threads_.emplace_back(&WorkStealingExecutor::workerLoop, this, i);
+    }
+
+    // Runs the tasks still queued, then joins the workers.
+    ~WorkStealingExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stopping_ = true;
+        }
+        wakeCondition_.notify_all();
+        for (std::thread& thread : threads_)
+            thread.join();
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    // Any thread.
+    void submit(T&& task)
+    {
+        size_t index = nextQueue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+        // counted before it is visible, so a worker taking it never drives pending_ below zero
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+            queues_[index]->tasks.push_back(std::move(task));
+        }
+        if (sleepers_.load() > 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            wakeCondition_.notify_one();
+        }
+    }
+
+    // Blocks until every submitted task has finished running.
+    void waitIdle()
+    {
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        idleCondition_.wait(lock, [this]() { return pending_.load() == 0 && active_.load() == 0; });
+    }
+
+    size_t workerCount() const { return threads_.size(); }
+
+    WorkStealingStats stats() const
+    {
+        return WorkStealingStats{ executed_.load(std::memory_order_relaxed), stolen_.load(std::memory_order_relaxed) };
+    }
+
+private:
+    // one per worker, on its own cache lines so workers do not contend on the locks' lines
+    struct alignas(64) WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<T> tasks;
+    };
+
+    bool takeOwn(size_t index, std::optional<T>& task)
+    {
+        WorkerQueue& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+        task.emplace(std::move(queue.tasks.front()));
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t index, std::optional<T>& task)
+    {
+        for (size_t i = 1; i < queues_.size(); ++i) {
+            WorkerQueue& victim = *queues_[(index + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task.emplace(std::move(victim.tasks.back()));
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index)
+    {
+        std::optional<T> task;
+        for (;;) {
+            bool stolen = false;
+            // active_ goes up before pending_ goes down, so waitIdle() never sees both at zero mid-task
+            active_.fetch_add(1);
+            if (takeOwn(index, task) || (stolen = steal(index, task))) {
+                pending_.fetch_sub(1);
+                handler_(*task);
+                task.reset();
+                executed_.fetch_add(1, std::memory_order_relaxed);
+                if (stolen)
+                    stolen_.fetch_add(1, std::memory_order_relaxed);
+                finishTask();
+                continue;
+            }
+            finishTask();
+
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            if (stopping_ && pending_.load() == 0)
+                return;
+            sleepers_.fetch_add(1);
+            wakeCondition_.wait(lock, [this]() { return pending_.load() > 0 || stopping_; });
+            sleepers_.fetch_sub(1);
+        }
+    }
+
+    void finishTask()
+    {
+        if (active_.fetch_sub(1) == 1 && pending_.load() == 0) {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            idleCondition_.notify_all();
+        }
+    }
+
+    Handler handler_;
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> nextQueue_{ 0 };
+    std::atomic<size_t> pending_{ 0 };  // submitted, not yet taken by a worker
+    std::atomic<size_t> active_{ 0 };   // workers currently looking for or running a task
+    std::atomic<size_t> sleepers_{ 0 };
+    std::mutex sleepMutex_;
+    std::condition_variable wakeCondition_;
+    std::condition_variable idleCondition_;
+    bool stopping_ = false;
+    std::atomic<uint64_t> executed_{ 0 };
+    std::atomic<uint64_t> stolen_{ 0 };
+};
@@ -6,29 +6,64 @@
 
 #include <thread>
 #include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <random>
+#include <cstdio>
 
 // Constructor
-// - store the connect address since we are using a proxy, create a ZMQ context with one IO thread
+// - store the connect address since we are using a proxy, share the process-wide
+//   ZMQ context unless one is given
 // - socket is not created until init() is called
-ZeroMQPublisher::ZeroMQPublisher(const std::string& connectAddress)
+ZeroMQPublisher::ZeroMQPublisher(const std::string& connectAddress, std::shared_ptr<zmq::context_t> context)
     : connectAddress_(connectAddress),
-    context_(1),
+    context_(context ? std::move(context) : ZmqContext::shared()),
     socket_(nullptr),
-    initialized_(false)
+    initialized_(false),
+    settings_(nullptr),
+    framesCompressed_(0),
+    framesSkipped_(0),
+    compressBytesIn_(0),
+    compressBytesOut_(0),
+    compressNanoseconds_(0),
+    batchTimerRunning_(false),
+    asyncRunning_(false),
+    asyncProducers_(0),
+    ioWaiting_(false),
+    ioWakeups_(0),
+    queueSent_(0),
+    queueRejected_(0),
+    queueSendErrors_(0),
+    backpressurePolicy_(BackpressurePolicy::DropNewest),
+    blockTimeoutMs_(100),
+    backlogLimit_(1024),
+    sendHighWaterMark_(1000),
+    droppedMessages_(0),
+    delayedMessages_(0),
+    backlogSize_(0),
+    readyTimeout_(kDefaultReadyTimeout),
+    readySubscribers_(1),
+    subscriptionSeen_(false),
+    sendsSinceDrain_(0)
 {
+    settingsVersions_.push_back(std::make_unique<EncodeSettings>());
+    settings_.store(settingsVersions_.back().get());
 }
 
 // Destructor
 // - ensure resources are cleaned up by calling close()
 ZeroMQPublisher::~ZeroMQPublisher()
 {
+    stopBatchTimer();
     close();
 }
 
 // init()
-// - Creates and binds a ZMQ PUB socket to the configured address
-// - Sets socket options (linger = 0 so close returns quickly)
-// - Small sleep to allow subscribers to connect (optional)
+// - Creates and connects a ZMQ XPUB socket to the configured address (XPUB
+//   publishes like PUB but also reads the subscriptions forwarded by the proxy)
+// - Sets socket options (linger = 0 so close returns quickly, send HWM, and
+//   no-drop so a full queue is reported to the backpressure policy)
+// - Waits (bounded) for the expected subscriptions instead of a fixed sleep
 // - Thread-safe using mutex
 // - Returns true on successful initialization
 bool ZeroMQPublisher::init()
@@ -38,10 +73,13 @@ bool ZeroMQPublisher::init()
         return true;
 
     try {
-        socket_ = std::make_unique<zmq::socket_t>(context_, zmq::socket_type::pub);
+        socket_ = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::xpub);
         // Set linger to 0 so close returns quickly
         int linger = 0;
         socket_->set(zmq::sockopt::linger, linger);
+        socket_->set(zmq::sockopt::sndhwm, sendHighWaterMark_);
+        int noDrop = 1;
+        socket_->set(zmq::sockopt::xpub_nodrop, noDrop);
 
         /*
         *** Not allowing sockets to bind to any address when we are running with a proxy ***
@@ -51,8 +89,9 @@ bool ZeroMQPublisher::init()
         */
         socket_->connect(connectAddress_);
 
-        // Give subscribers a moment to connect (optional small pause)
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // slow joiner: return once the subscriptions made it through the proxy,
+        // rather than sleeping a fixed 100 ms and hoping
+        waitForSubscribersLocked(readyTopics_, readyTimeout_, readySubscribers_);
 
         initialized_ = true;
         return true;
@@ -71,6 +110,9 @@ bool ZeroMQPublisher::init()
 // - Resets internal state; context is cleaned up by its destructor
 void ZeroMQPublisher::close()
 {
+    // the I/O thread uses the socket without the mutex, it has to be gone first
+    stopAsync();
+
     std::lock_guard<std::mutex> lock(mutex_);
     if (socket_) {
         try {
@@ -82,525 +124,1814 @@ void ZeroMQPublisher::close()
         socket_.reset();
     }
     initialized_ = false;
-    // context_ will be cleaned up in destructor
+    // context_ is released with the last wrapper sharing it
 }
 
 
-// publish(topic, message)
-// overloaded to send just a request publish(topic)
-// or to send the response topic w/ payload publish(topic, payload)
-// Ensures the socket is initialized, then sends a multipart message
-// Uses a mutex to make publishing thread-safe
-// Any ZMQ errors are caught and logged
+// setReadiness()
+// - What init() waits for before returning, and for how long at most
+void ZeroMQPublisher::setReadiness(const std::vector<std::string>& topics, std::chrono::milliseconds timeout, int subscribersPerTopic)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    readyTopics_ = topics;
+    readyTimeout_ = timeout;
+    readySubscribers_ = subscribersPerTopic;
+}
 
-bool ZeroMQPublisher::publish(const std::string& topic)
+// waitForSubscribers()
+// - Blocks until topics are covered by forwarded subscriptions, or timeout
+bool ZeroMQPublisher::waitForSubscribers(const std::vector<std::string>& topics, std::chrono::milliseconds timeout,
+    int subscribersPerTopic)
 {
-    // Ensure socket is initialized
     if (!initialized_) {
         if (!init())
             return false;
     }
+    if (asyncRunning_.load())
+        return false; // the I/O thread owns the socket
+
     std::lock_guard<std::mutex> lock(mutex_);
+    return waitForSubscribersLocked(topics, timeout, subscribersPerTopic);
+}
 
+// waitForSubscribersLocked()
+// - Reads subscription events until the expected topics are covered or the
+//   deadline passes
+bool ZeroMQPublisher::waitForSubscribersLocked(const std::vector<std::string>& topics, std::chrono::milliseconds timeout,
+    int subscribersPerTopic)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
     try {
-
-        zmq::const_buffer topicBuf(topic.data(), topic.size());
-
-        socket_->send(topicBuf, zmq::send_flags::none);
-      
-        return true;
+        zmq::message_t event;
+        for (;;) {
+            // take whatever is already queued before deciding
+            drainSubscriptionEvents();
+            if (subscribersReady(topics, subscribersPerTopic))
+                return true;
+
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (remaining.count() <= 0)
+                return false;
+            if (!recvWithin(event, static_cast<int>(remaining.count())))
+                return false; // timed out
+            applySubscriptionEvent(event);
+        }
     }
     catch (const zmq::error_t& e) {
-        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
+        std::cerr << "ZeroMQPublisher readiness error: " << e.what() << "\n";
         return false;
     }
 }
 
-bool ZeroMQPublisher::publish(const std::string& topic, const AppStatus& message)
+// recvWithin()
+// - A waiting recv bounded by timeoutMs; rcvtimeo only applies to this recv, so
+//   the socket is left as init() configured it
+bool ZeroMQPublisher::recvWithin(zmq::message_t& message, int timeoutMs)
 {
-    // Ensure socket is initialized
-    if (!initialized_) {
-        if (!init())
-            return false;
-    }
-
-    std::lock_guard<std::mutex> lock(mutex_);
-
+    socket_->set(zmq::sockopt::rcvtimeo, timeoutMs);
+    bool received = false;
     try {
+        received = socket_->recv(message, zmq::recv_flags::none).has_value();
+    }
+    catch (const zmq::error_t&) {
+        socket_->set(zmq::sockopt::rcvtimeo, -1);
+        throw;
+    }
+    socket_->set(zmq::sockopt::rcvtimeo, -1);
+    return received;
+}
 
-        zmq::const_buffer topicBuf(topic.data(), topic.size());
-        // Serialize the payload first based on what topic is, then send topic 
-        // and payload as first and second frame respectively
-
-        std::string s = serialize(message);
-        zmq::message_t payload(s.size());
-        std::memcpy(payload.data(), s.data(), s.size());
-
-        socket_->send(topicBuf, zmq::send_flags::sndmore);
-
-        socket_->send(payload, zmq::send_flags::none);
+// drainSubscriptionEvents()
+// - Applies every subscription event already queued on the socket, so the
+//   events that arrive after init() do not accumulate unread
+void ZeroMQPublisher::drainSubscriptionEvents()
+{
+    zmq::message_t event;
+    while (socket_->recv(event, zmq::recv_flags::dontwait))
+        applySubscriptionEvent(event);
+    sendsSinceDrain_ = 0;
+}
 
-        return true;
+// applySubscriptionEvent()
+// - [1]prefix subscribes, [0]prefix unsubscribes
+// - A readiness marker adds or removes its subscriber under the marked filter;
+//   any other prefix is a plain subscription. The proxy forwards an unsubscribe
+//   once nobody holds the prefix any more, so it simply clears it
+void ZeroMQPublisher::applySubscriptionEvent(const zmq::message_t& event)
+{
+    if (event.size() == 0)
+        return;
+    const char* bytes = static_cast<const char*>(event.data());
+    std::string prefix(bytes + 1, event.size() - 1);
+    size_t tag = prefix.find(kReadinessMarkerTag);
+    if (bytes[0] == 1) {
+        if (tag == std::string::npos)
+            subscriptions_.insert(prefix);
+        else
+            subscribers_[prefix.substr(0, tag)].insert(prefix.substr(tag + kReadinessMarkerTag.size()));
+        subscriptionSeen_ = true;
     }
-    catch (const zmq::error_t& e) {
-        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
-        return false;
+    else if (bytes[0] == 0) {
+        if (tag == std::string::npos) {
+            subscriptions_.erase(prefix);
+            return;
+        }
+        auto it = subscribers_.find(prefix.substr(0, tag));
+        if (it != subscribers_.end()) {
+            it->second.erase(prefix.substr(tag + kReadinessMarkerTag.size()));
+            if (it->second.empty())
+                subscribers_.erase(it);
+        }
     }
 }
 
-bool ZeroMQPublisher::publish(const std::string& topic, const AppDataRequest1& message)
+// subscribersReady()
+// - Every topic needs subscribersPerTopic distinct subscribers among the marked
+//   filters covering it; a covering plain subscription alone counts as one
+//   (a subscriber that sends no markers). No topics means any subscription will do
+bool ZeroMQPublisher::subscribersReady(const std::vector<std::string>& topics, int subscribersPerTopic) const
+{
+    if (topics.empty())
+        return subscriptionSeen_;
+    std::unordered_set<std::string_view> ids;
+    for (const std::string& topic : topics) {
+        ids.clear();
+        for (const auto& [filter, subscribers] : subscribers_) {
+            if (topic.compare(0, filter.size(), filter) == 0)
+                ids.insert(subscribers.begin(), subscribers.end());
+        }
+        int count = static_cast<int>(ids.size());
+        if (count == 0) {
+            for (const std::string& subscription : subscriptions_) {
+                if (topic.compare(0, subscription.size(), subscription) == 0) {
+                    count = 1;
+                    break;
+                }
+            }
+        }
+        if (count < subscribersPerTopic)
+            return false;
+    }
+    return true;
+}
+
+// startAsync()
+// - Initializes the socket if needed, creates the send queue and starts the I/O thread
+// - From here on publish() only encodes and enqueues
+bool ZeroMQPublisher::startAsync(size_t queueCapacity)
 {
-    // Ensure socket is initialized
     if (!initialized_) {
         if (!init())
             return false;
     }
 
     std::lock_guard<std::mutex> lock(mutex_);
+    if (asyncRunning_.load())
+        return true;
 
-    try {
+    if (!sendQueue_ || sendQueue_->capacity() < queueCapacity)
+        sendQueue_ = std::make_unique<MpscRing<OutgoingMessage>>(queueCapacity);
+    asyncRunning_.store(true);
+    ioThread_ = std::thread(&ZeroMQPublisher::ioLoop, this);
+    return true;
+}
 
-        zmq::const_buffer topicBuf(topic.data(), topic.size());
-        // Serialize the payload first based on what topic is, then send topic 
-        // and payload as first and second frame respectively
+// stopAsync()
+// - Lets the I/O thread drain the queue, joins it and returns to synchronous sends
+// - Once the flag is cleared no new producer takes the lock-free path; the ones
+//   already on it (see AsyncProducer) are waited for, so nothing reaches the ring
+//   after the final drain
+// - Holds mutex_ so no synchronous send touches the socket while the I/O thread
+//   is still draining; the lock-free producers never take it
+void ZeroMQPublisher::stopAsync()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!asyncRunning_.exchange(false, std::memory_order_seq_cst))
+        return;
 
-        std::string s = serialize(message);
-        zmq::message_t payload(s.size());
-        std::memcpy(payload.data(), s.data(), s.size());
+    // an encode plus a push, so a short spin
+    while (asyncProducers_.load(std::memory_order_seq_cst) != 0)
+        std::this_thread::yield();
 
-        socket_->send(topicBuf, zmq::send_flags::sndmore);
+    ioWakeups_.fetch_add(1);
+    ioWakeups_.notify_one();
+    if (ioThread_.joinable())
+        ioThread_.join();
 
-        socket_->send(payload, zmq::send_flags::none);
+    OutgoingMessage message;
+    while (sendQueue_->tryPop(message))
+        transmit(message);
+}
 
-        return true;
-    }
-    catch (const zmq::error_t& e) {
-        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
+// sendQueueStats()
+// - Snapshot of the asynchronous send counters
+ZeroMQPublisher::SendQueueStats ZeroMQPublisher::sendQueueStats() const
+{
+    return SendQueueStats{ queueSent_.load(std::memory_order_relaxed),
+        queueRejected_.load(std::memory_order_relaxed),
+        queueSendErrors_.load(std::memory_order_relaxed) };
+}
+
+// enqueue()
+// - Lock-free hand-off to the I/O thread; wakes it only if it is parked
+bool ZeroMQPublisher::enqueue(OutgoingMessage&& message)
+{
+    if (!sendQueue_->tryPush(std::move(message))) {
+        queueRejected_.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
+    // pairs with the fence in ioLoop(): either the I/O thread sees the new
+    // message before parking, or we see it parked and wake it up
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ioWaiting_.load(std::memory_order_relaxed)) {
+        ioWakeups_.fetch_add(1, std::memory_order_release);
+        ioWakeups_.notify_one();
+    }
+    return true;
 }
 
-bool ZeroMQPublisher::publish(const std::string& topic, const AppDataRequest2& message)
+// setBackpressurePolicy() / setSendHighWaterMark() / backpressureStats()
+// - The policy settings are atomics because the I/O thread reads them while sending
+void ZeroMQPublisher::setBackpressurePolicy(BackpressurePolicy policy, std::chrono::milliseconds blockTimeout, size_t backlogLimit)
 {
-    // Ensure socket is initialized
-    if (!initialized_) {
-        if (!init())
-            return false;
-    }
+    backpressurePolicy_.store(policy);
+    blockTimeoutMs_.store(static_cast<int>(blockTimeout.count()));
+    backlogLimit_.store(backlogLimit ? backlogLimit : 1);
+}
 
+void ZeroMQPublisher::setSendHighWaterMark(int messages)
+{
     std::lock_guard<std::mutex> lock(mutex_);
+    sendHighWaterMark_ = messages;
+}
 
-    try {
-
-        zmq::const_buffer topicBuf(topic.data(), topic.size());
-        // Serialize the payload first based on what topic is, then send topic 
-        // and payload as first and second frame respectively
-
-        std::string s = serialize(message);
-        zmq::message_t payload(s.size());
-        std::memcpy(payload.data(), s.data(), s.size());
-
-        socket_->send(topicBuf, zmq::send_flags::sndmore);
+ZeroMQPublisher::BackpressureStats ZeroMQPublisher::backpressureStats() const
+{
+    return BackpressureStats{ droppedMessages_.load(std::memory_order_relaxed),
+        delayedMessages_.load(std::memory_order_relaxed),
+        backlogSize_.load(std::memory_order_relaxed) };
+}
 
-        socket_->send(payload, zmq::send_flags::none);
+// topicOf()
+// - The topic a message was published under: its own frame for multipart
+//   messages and bare requests, the part before the NUL for envelopes
+std::string_view ZeroMQPublisher::topicOf(const OutgoingMessage& message)
+{
+    const char* bytes = static_cast<const char*>(message.first.data());
+    size_t size = message.first.size();
+    if (!message.multipart) {
+        if (const void* separator = std::memchr(bytes, '\0', size))
+            size = static_cast<size_t>(static_cast<const char*>(separator) - bytes);
+    }
+    return std::string_view(bytes, size);
+}
 
+// trySend()
+// - One attempt at writing the frames of a message; only the first frame can hit
+//   the high-water mark, later frames of a multipart message are always accepted
+bool ZeroMQPublisher::trySend(OutgoingMessage& message, bool wait)
+{
+    zmq::send_flags flags = wait ? zmq::send_flags::none : zmq::send_flags::dontwait;
+    if (message.multipart) {
+        if (!socket_->send(message.first, zmq::send_flags::sndmore | flags))
+            return false;
+        socket_->send(message.second, zmq::send_flags::none);
         return true;
     }
-    catch (const zmq::error_t& e) {
-        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
-        return false;
-    }
+    return socket_->send(message.first, flags).has_value();
 }
 
-std::string ZeroMQPublisher::serialize(const AppStatus& message)
+// trySendWithin()
+// - A waiting send bounded by timeoutMs; sndtimeo only applies to this send
+bool ZeroMQPublisher::trySendWithin(OutgoingMessage& message, int timeoutMs)
 {
-    std::ostringstream oss(std::ios::binary);
-    
-    size_t appId_size = message.appId.size();
-    oss.write(reinterpret_cast<const char*>(&appId_size), sizeof(appId_size));
-    oss.write(message.appId.data(), appId_size);
-
-    size_t appHealth_size = message.appHealth.size();
-    oss.write(reinterpret_cast<const char*>(&appHealth_size), sizeof(appHealth_size));
-    oss.write(message.appHealth.data(), appHealth_size);
+    socket_->set(zmq::sockopt::sndtimeo, timeoutMs);
+    bool sent = false;
+    try {
+        sent = trySend(message, true);
+    }
+    catch (const zmq::error_t&) {
+        socket_->set(zmq::sockopt::sndtimeo, -1);
+        throw;
+    }
+    socket_->set(zmq::sockopt::sndtimeo, -1);
+    return sent;
+}
 
-    oss.write(reinterpret_cast<const char*>(&message.appRuntime), sizeof(message.appRuntime));
-        
-    return oss.str();
+// flushBacklog()
+// - Sends backlogged messages oldest first, stopping when the socket is full again
+void ZeroMQPublisher::flushBacklog()
+{
+    while (!backlog_.empty()) {
+        if (!trySend(backlog_.front(), false))
+            break;
+        backlog_.pop_front();
+        queueSent_.fetch_add(1, std::memory_order_relaxed);
+    }
+    backlogSize_.store(backlog_.size(), std::memory_order_relaxed);
 }
 
-std::string ZeroMQPublisher::serialize(const AppDataRequest1& message)
+// transmit()
+// - Writes one message, applying the backpressure policy when the socket is full
+// - Errors other than a full queue are logged and counted as send errors
+ZeroMQPublisher::SendResult ZeroMQPublisher::transmit(OutgoingMessage& message)
 {
-    std::ostringstream oss(std::ios::binary);
-    
-    size_t appId_size = message.appId.size();
-    oss.write(reinterpret_cast<const char*>(&appId_size), sizeof(appId_size));
-    oss.write(message.appId.data(), appId_size);
+    try {
+        BackpressurePolicy policy = backpressurePolicy_.load(std::memory_order_relaxed);
 
-    size_t appHealth_size = message.appHealth.size();
-    oss.write(reinterpret_cast<const char*>(&appHealth_size), sizeof(appHealth_size));
-    oss.write(message.appHealth.data(), appHealth_size);
+        if (++sendsSinceDrain_ >= kSubscriptionDrainInterval)
+            drainSubscriptionEvents();
 
-    oss.write(reinterpret_cast<const char*>(&message.numberToAdd), sizeof(message.numberToAdd));
-    
+        // backlogged messages go first, so nothing overtakes them
+        if (!backlog_.empty())
+            flushBacklog();
+
+        if (backlog_.empty() && trySend(message, false)) {
+            queueSent_.fetch_add(1, std::memory_order_relaxed);
+            return SendResult::Sent;
+        }
 
-    return oss.str();
+        switch (policy) {
+        case BackpressurePolicy::Block: {
+            delayedMessages_.fetch_add(1, std::memory_order_relaxed);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(blockTimeoutMs_.load(std::memory_order_relaxed));
+            auto remainingMs = [&deadline] {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+                return left.count() > 0 ? static_cast<int>(left.count()) : 0;
+            };
+            // a backlog left by an earlier DropOldest / Conflate policy is older
+            // than this message, so it gets the wait first
+            while (!backlog_.empty() && trySendWithin(backlog_.front(), remainingMs())) {
+                backlog_.pop_front();
+                queueSent_.fetch_add(1, std::memory_order_relaxed);
+            }
+            backlogSize_.store(backlog_.size(), std::memory_order_relaxed);
+            if (backlog_.empty() && trySendWithin(message, remainingMs())) {
+                queueSent_.fetch_add(1, std::memory_order_relaxed);
+                return SendResult::Sent;
+            }
+            droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+            return SendResult::Dropped;
+        }
+        case BackpressurePolicy::DropNewest:
+            droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+            return SendResult::Dropped;
+        case BackpressurePolicy::Conflate: {
+            // a newer message for a backlogged topic replaces the older one
+            std::string_view topic = topicOf(message);
+            for (OutgoingMessage& queued : backlog_) {
+                if (topicOf(queued) == topic) {
+                    queued = std::move(message);
+                    droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+                    return SendResult::Deferred;
+                }
+            }
+            [[fallthrough]];
+        }
+        case BackpressurePolicy::DropOldest:
+            delayedMessages_.fetch_add(1, std::memory_order_relaxed);
+            backlog_.push_back(std::move(message));
+            if (backlog_.size() > backlogLimit_.load(std::memory_order_relaxed)) {
+                backlog_.pop_front();
+                droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+            }
+            backlogSize_.store(backlog_.size(), std::memory_order_relaxed);
+            return SendResult::Deferred;
+        }
+        return SendResult::Dropped;
+    }
+    catch (const zmq::error_t& e) {
+        std::cerr << "ZeroMQPublisher send error: " << e.what() << "\n";
+        queueSendErrors_.fetch_add(1, std::memory_order_relaxed);
+        return SendResult::Dropped;
+    }
 }
 
-std::string ZeroMQPublisher::serialize(const AppDataRequest2& message)
+// ioLoop()
+// - Body of the I/O thread: drains the send queue into the socket
+// - Spins briefly when the queue runs dry, then parks until enqueue() wakes it
+//   (unless there is a backlog to retry)
+// - Exits once stopAsync() was called and the queue is empty
+void ZeroMQPublisher::ioLoop()
 {
-    std::ostringstream oss(std::ios::binary);
-
-    size_t appId_size = message.appId.size();
-    oss.write(reinterpret_cast<const char*>(&appId_size), sizeof(appId_size));
-    oss.write(message.appId.data(), appId_size);
-
-    size_t appHealth_size = message.appHealth.size();
-    oss.write(reinterpret_cast<const char*>(&appHealth_size), sizeof(appHealth_size));
-    oss.write(message.appHealth.data(), appHealth_size);
-
-    oss.write(reinterpret_cast<const char*>(&message.numberToMultiply), sizeof(message.numberToMultiply));
+    constexpr int kSpinsBeforePark = 64;
+
+    OutgoingMessage message;
+    int idleSpins = 0;
+    for (;;) {
+        if (sendQueue_->tryPop(message)) {
+            transmit(message);
+            idleSpins = 0;
+            continue;
+        }
+        if (!asyncRunning_.load(std::memory_order_acquire))
+            break;
+        if (!backlog_.empty()) {
+            // nothing new to send, but backlogged messages wait for room in the socket
+            try {
+                flushBacklog();
+            }
+            catch (const zmq::error_t& e) {
+                std::cerr << "ZeroMQPublisher send error: " << e.what() << "\n";
+            }
+            if (!backlog_.empty())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        if (++idleSpins < kSpinsBeforePark) {
+            std::this_thread::yield();
+            continue;
+        }
+        try {
+            // subscriptions that arrived since the last burst, before going to sleep
+            drainSubscriptionEvents();
+        }
+        catch (const zmq::error_t& e) {
+            std::cerr << "ZeroMQPublisher readiness error: " << e.what() << "\n";
+        }
 
+        uint32_t wakeups = ioWakeups_.load(std::memory_order_acquire);
+        ioWaiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sendQueue_->empty() && asyncRunning_.load(std::memory_order_acquire))
+            ioWakeups_.wait(wakeups, std::memory_order_acquire);
+        ioWaiting_.store(false, std::memory_order_relaxed);
+        idleSpins = 0;
+    }
+}
 
-    return oss.str();
+// changeSettings()
+// - Copy-on-write: the current settings are copied, changed and published with
+//   one pointer swap, so publish() never sees a half-applied change
+template<typename Change>
+void ZeroMQPublisher::changeSettings(Change&& change)
+{
+    std::lock_guard<std::mutex> lock(settingsMutex_);
+    auto next = std::make_unique<EncodeSettings>(*settings_.load(std::memory_order_relaxed));
+    change(*next);
+    settings_.store(next.get(), std::memory_order_release);
+    settingsVersions_.push_back(std::move(next));
 }
 
+// compressionThresholdFor()
+// - The topic's own threshold if it has one, else the default
+size_t ZeroMQPublisher::EncodeSettings::compressionThresholdFor(const std::string& topic) const
+{
+    if (!topicCompressionThresholds.empty()) {
+        auto it = topicCompressionThresholds.find(topic);
+        if (it != topicCompressionThresholds.end())
+            return it->second;
+    }
+    return compressionThreshold;
+}
 
-// -------------------- Subscriber implementation --------------------
+// setWireFormat()
+// - Chooses the encoding used by every following publish(topic, message)
+void ZeroMQPublisher::setWireFormat(WireFormat format)
+{
+    changeSettings([format](EncodeSettings& settings) { settings.wireFormat = format; });
+}
 
-// Constructor
-// - store connect address and topic filter, create context
-ZeroMQSubscriber::ZeroMQSubscriber(const std::string& connectAddress, const std::vector<std::string>& topicFilters)
-    : connectAddress_(connectAddress),
-    topicFilters_(topicFilters),
-    context_(1),
-    socket_(nullptr),
-    initialized_(false),
-    callback_(nullptr),
-    thread_(),
-    running_(false)
+// setCompressionThreshold()
+// - Payloads above the threshold are compressed; the topic overload wins over the default
+void ZeroMQPublisher::setCompressionThreshold(size_t bytes)
 {
+    changeSettings([bytes](EncodeSettings& settings) { settings.compressionThreshold = bytes; });
 }
 
-// Destructor
-// - ensure receiving is stopped and resources are released
-ZeroMQSubscriber::~ZeroMQSubscriber()
+void ZeroMQPublisher::setCompressionThreshold(const std::string& topic, size_t bytes)
 {
-    stop();
-    close();
+    changeSettings([&topic, bytes](EncodeSettings& settings) { settings.topicCompressionThresholds[topic] = bytes; });
 }
 
-// init()
-// - Create a SUB socket, connect to the given address and set the subscription filter(s)
-// - Sets a small receive timeout so the run loop can check the running_ flag periodically
-bool ZeroMQSubscriber::init()
+// setChecksumEnabled()
+// - Toggles the CRC32C trailer on compact payloads
+void ZeroMQPublisher::setChecksumEnabled(bool enabled)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (initialized_)
-        return true;
+    changeSettings([enabled](EncodeSettings& settings) { settings.checksumEnabled = enabled; });
+}
 
-    try {
-        socket_ = std::make_unique<zmq::socket_t>(context_, zmq::socket_type::sub);
-        // Do not block forever on close
-        int linger = 0;
-        socket_->set(zmq::sockopt::linger, linger);
+// setEnvelopeEnabled()
+// - Switches between two-frame and single-frame (envelope) payload messages
+void ZeroMQPublisher::setEnvelopeEnabled(bool enabled)
+{
+    changeSettings([enabled](EncodeSettings& settings) { settings.envelopeEnabled = enabled; });
+}
 
-        // Connect to the publisher
-        socket_->connect(connectAddress_);
+// compressionStats()
+// - Snapshot of the compression counters; the fields are read one by one, so
+//   they can be a message apart while publishers are running
+ZeroMQPublisher::CompressionStats ZeroMQPublisher::compressionStats() const
+{
+    return CompressionStats{ framesCompressed_.load(std::memory_order_relaxed),
+        framesSkipped_.load(std::memory_order_relaxed),
+        compressBytesIn_.load(std::memory_order_relaxed),
+        compressBytesOut_.load(std::memory_order_relaxed),
+        compressNanoseconds_.load(std::memory_order_relaxed) };
+}
 
-        // Subscribe to the provided topic filters. If none provided, subscribe to everything using empty filter.
-        if (topicFilters_.empty()) {
-            socket_->set(zmq::sockopt::subscribe, std::string(""));
-        }
-        else {
-            for (const auto& f : topicFilters_) {
-                socket_->set(zmq::sockopt::subscribe, f);
-            }
-        }
+// publish(topic, message)
+// overloaded to send just a request publish(topic)
+// or to send the response topic w/ payload publish(topic, payload)
+// Ensures the socket is initialized, then sends a multipart message
+// Thread-safe: lock-free in asynchronous mode, under the mutex otherwise
+// Any ZMQ errors are caught and logged
 
-        // Set a short receive timeout so the run loop is responsive to stop()
-        int rcvTimeoutMs = 100; // milliseconds
-        socket_->set(zmq::sockopt::rcvtimeo, rcvTimeoutMs);
+bool ZeroMQPublisher::publish(const std::string& topic)
+{
+    // Ensure socket is initialized
+    if (!initialized_) {
+        if (!init())
+            return false;
+    }
 
-        initialized_ = true;
-        return true;
+    try {
+        return deliver(topic, nullptr, encodeSettings());
     }
     catch (const zmq::error_t& e) {
-        std::cerr << "ZeroMQSubscriber init error: " << e.what() << "\n";
-        socket_.reset();
-        initialized_ = false;
+        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
         return false;
     }
 }
 
-// start()
-// - Starts a background thread that receives messages and invokes the callback
-void ZeroMQSubscriber::start(std::function<void(const std::string&, std::unique_ptr<Message>)> callback)
+// publishBatch(items)
+// - One initialization check, one settings snapshot and one lock for the whole
+//   batch (no lock in asynchronous mode)
+// - A message that cannot be delivered does not stop the rest; it is counted
+//   where a single publish() counts it (droppedMessages_ or queueRejected_)
+size_t ZeroMQPublisher::publishBatch(std::span<const PublishItem> items)
 {
-    if (!callback)
-        return;
+    if (items.empty())
+        return 0;
 
-    // Initialize socket if necessary
+    // Ensure socket is initialized
     if (!initialized_) {
         if (!init())
-            return;
+            return 0;
     }
 
-    // If already running, do nothing
-    bool expected = false;
-    if (!running_.compare_exchange_strong(expected, true))
-        return;
+    const EncodeSettings& settings = encodeSettings();
+    auto publishAll = [&](auto&& send) {
+        size_t sent = 0;
+        for (const PublishItem& item : items) {
+            try {
+                OutgoingMessage outgoing = std::visit([&](const auto& message) {
+                    using M = std::decay_t<decltype(message)>;
+                    if constexpr (std::is_same<M, std::monostate>::value) {
+                        return makeOutgoing(item.first, nullptr, settings);
+                    }
+                    else {
+                        zmq::message_t payload = encodePayload(item.first, message, settings);
+                        return makeOutgoing(item.first, &payload, settings);
+                    }
+                }, item.second);
+                if (send(std::move(outgoing)))
+                    ++sent;
+            }
+            catch (const zmq::error_t& e) {
+                std::cerr << "ZeroMQPublisher publish batch error: " << e.what() << "\n";
+                droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        return sent;
+    };
 
-    callback_ = std::move(callback);
-    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
+    if (asyncRunning_.load(std::memory_order_relaxed)) {
+        AsyncProducer producer(*this);
+        if (producer.active())
+            return publishAll([this](OutgoingMessage&& outgoing) { return enqueue(std::move(outgoing)); });
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    return publishAll([this](OutgoingMessage&& outgoing) { return deliverLocked(std::move(outgoing)); });
 }
 
-// stop()
-// - Signals the background thread to stop and joins it
-void ZeroMQSubscriber::stop()
+// makeOutgoing(topic, payload)
+// - Topic and payload as first and second frame respectively; an envelope
+//   payload already carries the topic and goes out alone
+ZeroMQPublisher::OutgoingMessage ZeroMQPublisher::makeOutgoing(const std::string& topic, zmq::message_t* payload,
+    const EncodeSettings& settings)
 {
-    bool expected = true;
-    if (!running_.compare_exchange_strong(expected, false))
-        return;
+    OutgoingMessage outgoing;
+    if (payload && settings.envelopeEnabled) {
+        outgoing.first = std::move(*payload);
+    }
+    else {
+        outgoing.first = zmq::message_t(topic.data(), topic.size());
+        if (payload) {
+            outgoing.second = std::move(*payload);
+            outgoing.multipart = true;
+        }
+    }
+    return outgoing;
+}
 
-    if (thread_.joinable())
-        thread_.join();
+// deliver(topic, payload)
+// - In asynchronous mode the frames are handed to the I/O thread without a lock
+// - Otherwise they are sent under mutex_ applying the backpressure policy
+// - Returns false if the message was rejected or dropped
+bool ZeroMQPublisher::deliver(const std::string& topic, zmq::message_t* payload, const EncodeSettings& settings)
+{
+    OutgoingMessage outgoing = makeOutgoing(topic, payload, settings);
+    if (asyncRunning_.load(std::memory_order_relaxed)) {
+        AsyncProducer producer(*this);
+        if (producer.active())
+            return enqueue(std::move(outgoing));
+    }
 
-    // Clear callback after stopping
-    callback_ = nullptr;
+    std::lock_guard<std::mutex> lock(mutex_);
+    return deliverLocked(std::move(outgoing));
 }
 
-// close()
-// - Close and release the socket and reset state
-void ZeroMQSubscriber::close()
+// deliverLocked()
+// - mutex_ held, which keeps stopAsync() out, so the queue is safe to use if
+//   startAsync() won the race for the lock
+bool ZeroMQPublisher::deliverLocked(OutgoingMessage&& outgoing)
 {
-    std::lock_guard<std::mutex> lock(mutex_);
-    stop();
+    if (asyncRunning_.load(std::memory_order_acquire))
+        return enqueue(std::move(outgoing));
+    return transmit(outgoing) != SendResult::Dropped;
+}
 
-    if (socket_) {
-        try {
-            socket_->close();
-        }
-        catch (const zmq::error_t& e) {
-            std::cerr << "ZeroMQSubscriber close socket error: " << e.what() << "\n";
-        }
-        socket_.reset();
-    }
-    initialized_ = false;
+// Batch
+// - Accumulates PublishItems and flushes them through publishBatch()
+// - Registers with the publisher, whose batch timer enforces maxLatency
+ZeroMQPublisher::Batch::Batch(ZeroMQPublisher& publisher, size_t maxMessages, std::chrono::microseconds maxLatency)
+    : publisher_(publisher),
+    maxMessages_(maxMessages ? maxMessages : 1),
+    maxLatency_(maxLatency),
+    count_(0),
+    dropped_(0),
+    deadline_(std::chrono::steady_clock::time_point::max())
+{
+    items_.reserve(maxMessages_);
+    publisher_.registerBatch(this);
 }
 
-// runLoop()
-// - Background loop that receives multipart messages (topic + message)
-// - Uses the short receive timeout set in init() so it can exit promptly when stop() is called
-void ZeroMQSubscriber::runLoop()
+ZeroMQPublisher::Batch::~Batch()
 {
-   
-    while (running_.load()) {
-        try {
+    // off the timer first, so it cannot flush a Batch being destroyed
+    publisher_.unregisterBatch(this);
+    flush();
+}
 
-            // Receive topic frame
-            zmq::message_t topicMsg;
-            auto res = socket_->recv(topicMsg, zmq::recv_flags::none);
-            if (!res) {
-                // timeout or interrupted, loop back and check running_
-                continue;
-            }
+ZeroMQPublisher::PublishItem& ZeroMQPublisher::Batch::next(const std::string& topic)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (count_ == maxMessages_ || (count_ && now - oldest_ >= maxLatency_))
+        flushLocked();
+    if (count_ == 0) {
+        oldest_ = now;
+        deadline_.store(now + maxLatency_, std::memory_order_relaxed);
+    }
+    if (count_ == items_.size())
+        items_.emplace_back();
+    PublishItem& item = items_[count_++];
+    item.first.assign(topic);
+    return item;
+}
 
-            std::string topic(static_cast<const char*>(topicMsg.data()), topicMsg.size());
-            // if topic was a request for data from other services, there will not be a payload frame, 
-            if (determineRequestOrResponse(topic) == "response")
-            {
-                //IF(determineRequestOrResponse(topic)
-                if (callback_)
-                    callback_(topic, nullptr);
+void ZeroMQPublisher::Batch::add(const std::string& topic)
+{
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next(topic).second.emplace<std::monostate>();
+        started = count_ == 1;
+    }
+    if (started)
+        publisher_.armBatchTimer();
+}
+
+size_t ZeroMQPublisher::Batch::flushIfDue()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count_ && std::chrono::steady_clock::now() - oldest_ >= maxLatency_)
+        return flushLocked();
+    return 0;
+}
+
+size_t ZeroMQPublisher::Batch::flush()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return flushLocked();
+}
+
+size_t ZeroMQPublisher::Batch::flushLocked()
+{
+    if (count_ == 0)
+        return 0;
+    size_t sent = publisher_.publishBatch(std::span<const PublishItem>(items_.data(), count_));
+    dropped_ += count_ - sent;
+    count_ = 0;
+    deadline_.store(std::chrono::steady_clock::time_point::max(), std::memory_order_relaxed);
+    return sent;
+}
+
+size_t ZeroMQPublisher::Batch::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return count_;
+}
+
+size_t ZeroMQPublisher::Batch::dropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+// registerBatch() / unregisterBatch()
+// - The first Batch starts the timer thread; it runs until the publisher is destroyed
+void ZeroMQPublisher::registerBatch(Batch* batch)
+{
+    std::lock_guard<std::mutex> lock(batchTimerMutex_);
+    batches_.push_back(batch);
+    if (!batchTimerRunning_) {
+        batchTimerRunning_ = true;
+        batchTimerThread_ = std::thread(&ZeroMQPublisher::batchTimerLoop, this);
+    }
+}
+
+void ZeroMQPublisher::unregisterBatch(Batch* batch)
+{
+    std::lock_guard<std::mutex> lock(batchTimerMutex_);
+    batches_.erase(std::remove(batches_.begin(), batches_.end(), batch), batches_.end());
+}
+
+// armBatchTimer()
+// - Taking the lock orders the wakeup after the timer's last deadline scan, so
+//   the new deadline is never missed
+void ZeroMQPublisher::armBatchTimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(batchTimerMutex_);
+    }
+    batchTimerWake_.notify_one();
+}
+
+// batchTimerLoop()
+// - Flushes the batches that are due and sleeps until the earliest pending
+//   deadline, or until armBatchTimer() reports a new one
+void ZeroMQPublisher::batchTimerLoop()
+{
+    using Clock = std::chrono::steady_clock;
+    std::unique_lock<std::mutex> lock(batchTimerMutex_);
+    while (batchTimerRunning_) {
+        Clock::time_point earliest = Clock::time_point::max();
+        for (Batch* batch : batches_) {
+            Clock::time_point deadline = batch->deadline_.load(std::memory_order_relaxed);
+            if (deadline <= Clock::now()) {
+                batch->flushIfDue();
+                deadline = batch->deadline_.load(std::memory_order_relaxed);
             }
-            // Receive payload frame
-            zmq::message_t msg;
-            auto res2 = socket_->recv(msg, zmq::recv_flags::none);
-            if (!res2) {
-                // incomplete message; 
-                continue;
-            } 
+            if (deadline < earliest)
+                earliest = deadline;
+        }
+        if (earliest == Clock::time_point::max())
+            batchTimerWake_.wait(lock);
+        else
+            batchTimerWake_.wait_until(lock, earliest);
+    }
+}
+
+// stopBatchTimer()
+// - Joins the timer thread; the batches have to be gone by then
+void ZeroMQPublisher::stopBatchTimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(batchTimerMutex_);
+        if (!batchTimerRunning_)
+            return;
+        batchTimerRunning_ = false;
+    }
+    batchTimerWake_.notify_one();
+    batchTimerThread_.join();
+}
+
+// compressPayload()
+// - Compresses the body of a compact payload (the header stays readable so the
+//   subscriber can still check the type and see the flag)
+// - Compressed layout: [header | kFlagCompressed][varint body size][LZ block]
+// - The envelope prefix is copied over as is
+// - Keeps the original payload if compression does not make it smaller
+void ZeroMQPublisher::compressPayload(zmq::message_t& payload, size_t prefixSize, size_t trailerSize)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    const char* bytes = static_cast<const char*>(payload.data());
+    const char* header = bytes + prefixSize;
+    const size_t headerSize = MessageCodec::kCompactHeaderSize;
+    const size_t plainSize = payload.size() - prefixSize;
+    const size_t bodySize = plainSize - headerSize - trailerSize;
+
+    // scratch space per thread, keeps its capacity between publishes
+    thread_local std::vector<char> compressBuffer;
+    size_t bound = LzCompressor::maxCompressedSize(bodySize);
+    if (compressBuffer.size() < bound)
+        compressBuffer.resize(bound);
+    size_t compressedSize = LzCompressor::compress(header + headerSize, bodySize, compressBuffer.data(), bound);
+    size_t framedSize = headerSize + CompactWireFormat::lengthSize(bodySize) + compressedSize + trailerSize;
+
+    compressNanoseconds_.fetch_add(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count()),
+        std::memory_order_relaxed);
+    compressBytesIn_.fetch_add(plainSize, std::memory_order_relaxed);
+
+    if (compressedSize == 0 || framedSize >= plainSize) {
+        framesSkipped_.fetch_add(1, std::memory_order_relaxed);
+        compressBytesOut_.fetch_add(plainSize, std::memory_order_relaxed);
+        return;
+    }
+
+    zmq::message_t compressed = SendBufferPool::shared().makeMessage(prefixSize + framedSize);
+    char* out = static_cast<char*>(compressed.data());
+    std::memcpy(out, bytes, prefixSize + headerSize);
+    out[prefixSize + MessageCodec::kCompactFlagsOffset] |= MessageCodec::kFlagCompressed;
+    out = CompactWireFormat::writeLength(out + prefixSize + headerSize, bodySize);
+    std::memcpy(out, compressBuffer.data(), compressedSize);
 
-            // unpacking the topic to be used and unpacking and determining payload to be deserialized
+    framesCompressed_.fetch_add(1, std::memory_order_relaxed);
+    compressBytesOut_.fetch_add(framedSize, std::memory_order_relaxed);
+    payload = std::move(compressed);
+}
 
-            std::string data(static_cast<const char*>(msg.data()), msg.size());
 
-            // invoking callback to pop out of loop and send the topic / payload to App
-            // context: these are reply's to requests from apps
-            if (callback_)
+// -------------------- Subscriber implementation --------------------
+
+namespace
+{
+    // Recycled strings for the topics of queued callback tasks that are not in
+    // the topic registry. A recycled string keeps its capacity, so once the pool
+    // has warmed up copying such a topic allocates nothing. Like MessagePool it is
+    // a function-local static, thread-safe, and keeps at most kMaxIdle strings.
+    class TopicStringPool
+    {
+    public:
+        static TopicStringPool& shared()
+        {
+            static TopicStringPool pool;
+            return pool;
+        }
+
+        std::string* acquire()
+        {
             {
-                //if receiving a status object 
-                if (determineRequestOrResponse(topic) == "statusRequest")
-                {
-                    callback_(topic, std::unique_ptr<Message>(new AppStatus(deserializeStatus(data))));
-                }
-                //if receiving a data object (either for addition or multiplication in this case)
-                else if (determineRequestOrResponse(topic) == "additionRequest")
-                {
-                    callback_(topic, std::unique_ptr<Message>(new AppDataRequest1(deserializeAddition(data))));
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!idle_.empty()) {
+                    std::string* topic = idle_.back();
+                    idle_.pop_back();
+                    return topic;
                 }
-                else if (determineRequestOrResponse(topic) == "multiplicationRequest")
-                {
-                    callback_(topic, std::unique_ptr<Message>(new AppDataRequest2(deserializeMultiplication(data))));
+            }
+            return new std::string();
+        }
+
+        void recycle(std::string* topic)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (idle_.size() < kMaxIdle) {
+                    idle_.push_back(topic);
+                    return;
                 }
+            }
+            delete topic;
+        }
+
+        ~TopicStringPool()
+        {
+            for (std::string* topic : idle_)
+                delete topic;
+        }
 
+    private:
+        static constexpr size_t kMaxIdle = 256;
 
-            }
-            // Invoke callback outside of any locks to avoid deadlocks, pulls me out of loop
-            /*  old mech
-            if (callback_) {
-                callback_(topic, msg.data());
-            }
-            */
+        TopicStringPool()
+        {
+            idle_.reserve(kMaxIdle);
         }
-        catch (const zmq::error_t& e) {
-            // EAGAIN indicates no message was available within the timeout
-            if (e.num() == EAGAIN) {
-                continue;
-            }
-            std::cerr << "ZeroMQSubscriber receive error: " << e.what() << "\n";
-            // In case of other errors, give a small pause to avoid busy-looping
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        std::mutex mutex_;
+        std::vector<std::string*> idle_;
+    };
+
+    // Payload decoders indexed by MessageTypeId (flat jump tables)
+    // handledFlags: header flags dispatchPayload() already dealt with
+    // decodes into a recycled object from the type's pool; its strings are
+    // assigned in place and keep their capacity
+    template<typename T>
+    MessagePtr decodeOwned(const char* payload, size_t size, uint8_t handledFlags)
+    {
+        std::unique_ptr<T, MessageDeleter> message = MessagePool<T>::shared().acquire();
+        MessageCodec::decode(payload, size, *message, handledFlags);
+        return MessagePtr(std::move(message));
+    }
+
+    template<typename T>
+    MessageVariant decodeValue(const char* payload, size_t size, uint8_t handledFlags)
+    {
+        MessageVariant message(std::in_place_type<T>);
+        MessageCodec::decode(payload, size, std::get<T>(message), handledFlags);
+        return message;
+    }
+
+    // the view takes the whole frame; offset skips an envelope prefix
+    template<typename View>
+    MessageViewVariant decodeView(zmq::message_t&& frame, size_t offset, uint8_t handledFlags)
+    {
+        return View(std::move(frame), offset, handledFlags);
+    }
+
+    using OwnedDecoder = MessagePtr(*)(const char*, size_t, uint8_t);
+    using ValueDecoder = MessageVariant(*)(const char*, size_t, uint8_t);
+    using ViewDecoder = MessageViewVariant(*)(zmq::message_t&&, size_t, uint8_t);
+
+    // the decoders of one type; MessageTypeId::None has none
+    template<typename T>
+    struct Decoders
+    {
+        static constexpr OwnedDecoder owned = &decodeOwned<T>;
+        static constexpr ValueDecoder value = &decodeValue<T>;
+        static constexpr ViewDecoder view = &decodeView<typename MessageViewFor<T>::type>;
+    };
+
+    template<>
+    struct Decoders<std::monostate>
+    {
+        static constexpr OwnedDecoder owned = nullptr;
+        static constexpr ValueDecoder value = nullptr;
+        static constexpr ViewDecoder view = nullptr;
+    };
+
+    // one entry per MessageVariant alternative, see makeMessageTable()
+    constexpr auto kOwnedDecoders = makeMessageTable<OwnedDecoder>([](auto type) {
+        return Decoders<typename decltype(type)::type>::owned;
+    });
+
+    constexpr auto kValueDecoders = makeMessageTable<ValueDecoder>([](auto type) {
+        return Decoders<typename decltype(type)::type>::value;
+    });
+
+    constexpr auto kViewDecoders = makeMessageTable<ViewDecoder>([](auto type) {
+        return Decoders<typename decltype(type)::type>::view;
+    });
+
+    // refuse to inflate compressed payloads beyond this (protects against bogus sizes)
+    constexpr size_t kMaxDecompressedSize = 64 * 1024 * 1024;
+
+    // Checks the CRC32C trailer of a compact payload. The frame is left untouched:
+    // its content may be shared with other subscribers of the same inproc XPUB.
+    // On success size is reduced to exclude the trailer; the trailer bytes stay in
+    // the frame, where the decoders ignore them.
+    bool verifyChecksum(const char* bytes, size_t& size)
+    {
+        if (size < MessageCodec::kCompactHeaderSize + MessageCodec::kChecksumSize)
+            return false;
+        const size_t covered = size - MessageCodec::kChecksumSize;
+        if (CompactWireFormat::readScalar<uint32_t>(bytes + covered) != Crc32c::compute(bytes, covered))
+            return false;
+        size = covered;
+        return true;
+    }
+
+    // Inflates the size byte compressed compact payload at bytes (checksum trailer
+    // already cut off) into plain, with both frame flags cleared. Returns false if
+    // the payload is malformed.
+    bool decompressPayload(const char* bytes, size_t size, zmq::message_t& plain)
+    {
+        const char* end = bytes + size;
+        const size_t headerSize = MessageCodec::kCompactHeaderSize;
+
+        size_t bodySize = 0;
+        const char* block = nullptr;
+        try {
+            block = CompactWireFormat::readLength(bytes + headerSize, end, bodySize);
         }
+        catch (const std::runtime_error&) {
+            return false;
+        }
+        if (bodySize > kMaxDecompressedSize)
+            return false;
+
+        plain.rebuild(headerSize + bodySize);
+        char* out = static_cast<char*>(plain.data());
+        std::memcpy(out, bytes, headerSize);
+        out[MessageCodec::kCompactFlagsOffset] &= ~(MessageCodec::kFlagCompressed | MessageCodec::kFlagChecksum);
+        if (!LzCompressor::decompress(block, static_cast<size_t>(end - block), out + headerSize, bodySize))
+            return false;
+        return true;
     }
+
+    // Runs the decode step of dispatchPayload(). A std::runtime_error from it means
+    // the payload is malformed (truncated, unknown flags): it is counted as a
+    // rejected frame and logged, and false is returned.
+    template<typename Decode>
+    bool decodeFrame(std::string_view topic, std::atomic<uint64_t>& rejected, Decode&& decode)
+    {
+        try {
+            decode();
+            return true;
+        }
+        catch (const std::runtime_error& e) {
+            rejected.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "ZeroMQSubscriber dropped undecodable payload on " << topic << ": " << e.what() << "\n";
+            return false;
+        }
+    }
+
+    // Runs a user callback. What it throws belongs to the application, not to the
+    // frame: it is counted in errors and logged, and the calling receive / worker
+    // thread goes on with the next message.
+    template<typename Callback>
+    void runCallback(std::atomic<uint64_t>& errors, Callback&& callback)
+    {
+        try {
+            callback();
+        }
+        catch (const std::exception& e) {
+            errors.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "ZeroMQSubscriber callback error: " << e.what() << "\n";
+        }
+    }
+
+    // legacy payloads carry no type ID, the topic classification decides instead
+}
+
+// Constructor
+// - store connect address and topic filter, share the process-wide context unless one is given
+ZeroMQSubscriber::ZeroMQSubscriber(const std::string& connectAddress, const std::vector<std::string>& topicFilters,
+    std::shared_ptr<zmq::context_t> context)
+    : connectAddress_(connectAddress),
+    topicFilters_(topicFilters),
+    context_(context ? std::move(context) : ZmqContext::shared()),
+    socket_(nullptr),
+    initialized_(false),
+    callback_(nullptr),
+    thread_(),
+    running_(false),
+    rejectedFrames_(0),
+    callbackErrors_(0),
+    topics_(TopicRegistry::serviceTopics())
+{
+    // readiness marker id: random, so subscribers in different processes differ
+    std::random_device random;
+    char id[17];
+    std::snprintf(id, sizeof(id), "%08x%08x", random(), random());
+    subscriberId_ = id;
+}
+
+// Destructor
+// - ensure receiving is stopped and resources are released
+ZeroMQSubscriber::~ZeroMQSubscriber()
+{
+    stop();
+    close();
 }
 
-// deserialize...()
-// takes in the serialized message casted as a string from ZeroMQ 
-// and hand-unpacks
-// Note: this is not the most efficient way of doing it, but requires no external libraries
-// i.e. ProtoBuffers, FlatBuffers
-AppStatus ZeroMQSubscriber::deserializeStatus(const std::string& s)
+// init()
+// - Create a SUB socket, connect to the given address and set the subscription filter(s)
+// - Creates the inproc control pair the run loop polls next to the data socket
+bool ZeroMQSubscriber::init()
 {
-    
-    AppStatus message;
-    
-    const char* ptr = s.data();
-    const char* end = ptr + s.size();
-    
-    auto read_raw = [&](void* dest, size_t size)
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (initialized_)
+        return true;
+
+    try {
+        socket_ = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::sub);
+        // Do not block forever on close
+        int linger = 0;
+        socket_->set(zmq::sockopt::linger, linger);
+
+        // Connect to the publisher
+        socket_->connect(connectAddress_);
+
+        // Subscribe to the provided topic filters. If none provided, subscribe to everything using empty filter.
+        // Each filter also gets this subscriber's readiness marker, so publishers
+        // can tell how many subscribers hold a topic.
+        if (topicFilters_.empty()) {
+            socket_->set(zmq::sockopt::subscribe, std::string(""));
+            socket_->set(zmq::sockopt::subscribe, readinessMarker("", subscriberId_));
+        }
+        else {
+            for (const auto& f : topicFilters_) {
+                socket_->set(zmq::sockopt::subscribe, f);
+                socket_->set(zmq::sockopt::subscribe, readinessMarker(f, subscriberId_));
+            }
+        }
+
+        // Typed routes join the topic registry, so one lookup per message finds them
+        topics_ = TopicRegistry::serviceTopics();
+        for (size_t i = 0; i < routes_.size(); ++i)
+            topics_.add(TopicRoute{ routes_[i].topic, TopicKind::Response, routes_[i].typeId, {}, static_cast<int>(i) });
+        topics_.build();
+
+        // Control channel: the run loop owns controlSocket_, other threads send
+        // commands through commandSocket_. inproc needs both ends on one context.
+        // Numbered rather than named after this: libzmq releases a closed inproc
+        // endpoint asynchronously, so a subscriber reusing a freed address could
+        // still find the name bound.
+        static std::atomic<uint64_t> controlEndpoints{ 0 };
+        std::string controlEndpoint = "inproc://zmq-subscriber-control-" + std::to_string(controlEndpoints.fetch_add(1));
+        controlSocket_ = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::pair);
+        controlSocket_->set(zmq::sockopt::linger, linger);
+        controlSocket_->bind(controlEndpoint);
         {
-            if (ptr + size > end)
-                throw std::runtime_error("Buffer underflow");
-            std::memcpy(dest, ptr, size);
-            ptr += size;
-        };
-    
-    size_t appId_size;
-    read_raw(&appId_size, sizeof(appId_size));
-    
-    message.appId.assign(ptr, appId_size);
-    ptr += appId_size;
-    
-    size_t appHealth_size;
-    read_raw(&appHealth_size, sizeof(appHealth_size));
-    
-    message.appHealth.assign(ptr, appHealth_size);
-    ptr += appHealth_size;
-    
-    read_raw(&message.appRuntime, sizeof(message.appRuntime));
-    
-    return message;
-    
-}
-AppDataRequest1 ZeroMQSubscriber::deserializeAddition(const std::string& s)
-{
-    AppDataRequest1 message;
-
-    const char* ptr = s.data();
-    const char* end = ptr + s.size();
-
-    auto read_raw = [&](void* dest, size_t size)
+            std::lock_guard<std::mutex> commandLock(commandMutex_);
+            commandSocket_ = std::make_unique<zmq::socket_t>(*context_, zmq::socket_type::pair);
+            commandSocket_->set(zmq::sockopt::linger, linger);
+            commandSocket_->connect(controlEndpoint);
+        }
+
+        initialized_ = true;
+        return true;
+    }
+    catch (const zmq::error_t& e) {
+        std::cerr << "ZeroMQSubscriber init error: " << e.what() << "\n";
+        socket_.reset();
+        controlSocket_.reset();
         {
-            if (ptr + size > end)
-                throw std::runtime_error("Buffer underflow");
-            std::memcpy(dest, ptr, size);
-            ptr += size;
-        };
+            std::lock_guard<std::mutex> commandLock(commandMutex_);
+            commandSocket_.reset();
+        }
+        initialized_ = false;
+        return false;
+    }
+}
 
-    size_t appId_size;
-    read_raw(&appId_size, sizeof(appId_size));
+// start()
+// - Starts a background thread that receives messages and invokes the callback
+void ZeroMQSubscriber::start(std::function<void(const std::string&, MessagePtr)> callback)
+{
+    if (!callback)
+        return;
 
-    message.appId.assign(ptr, appId_size);
-    ptr += appId_size;
+    // Initialize socket if necessary
+    if (!initialized_) {
+        if (!init())
+            return;
+    }
 
-    size_t appHealth_size;
-    read_raw(&appHealth_size, sizeof(appHealth_size));
+    // If already running, do nothing
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return;
 
-    message.appHealth.assign(ptr, appHealth_size);
-    ptr += appHealth_size;
+    callback_ = std::move(callback);
+    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
+}
 
-    read_raw(&message.numberToAdd, sizeof(message.numberToAdd));
+// start()
+// - Starts the background thread for the typed subscribe<T>() routes alone
+void ZeroMQSubscriber::start()
+{
+    if (routes_.empty())
+        return;
 
-    return message;
+    // Initialize socket if necessary
+    if (!initialized_) {
+        if (!init())
+            return;
+    }
 
+    // If already running, do nothing
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return;
 
+    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
 }
-AppDataRequest2 ZeroMQSubscriber::deserializeMultiplication(const std::string& s)
+
+// topicRoute()
+// - The registry entry for topic, if any
+const TopicRoute* ZeroMQSubscriber::topicRoute(std::string_view topic) const
 {
-    AppDataRequest2 message;
+    return topics_.find(topic);
+}
 
-    const char* ptr = s.data();
-    const char* end = ptr + s.size();
+// startViews()
+// - Same as start(), but the background thread hands the callback zero-copy
+//   views over the received frames instead of decoded Message objects
+void ZeroMQSubscriber::startViews(ViewCallback callback)
+{
+    if (!callback)
+        return;
 
-    auto read_raw = [&](void* dest, size_t size)
-        {
-            if (ptr + size > end)
-                throw std::runtime_error("Buffer underflow");
-            std::memcpy(dest, ptr, size);
-            ptr += size;
+    // Initialize socket if necessary
+    if (!initialized_) {
+        if (!init())
+            return;
+    }
+
+    // If already running, do nothing
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return;
+
+    viewCallback_ = std::move(callback);
+    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
+}
+
+// startValues()
+// - Same as start(), but payloads are decoded into a MessageVariant by value
+void ZeroMQSubscriber::startValues(ValueCallback callback)
+{
+    if (!callback)
+        return;
+
+    // Initialize socket if necessary
+    if (!initialized_) {
+        if (!init())
+            return;
+    }
+
+    // If already running, do nothing
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return;
+
+    valueCallback_ = std::move(callback);
+    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
+}
+
+// startBatches()
+// - Same as startValues(), but the callback receives every message drained in
+//   one wakeup at once
+void ZeroMQSubscriber::startBatches(BatchCallback callback)
+{
+    if (!callback)
+        return;
+
+    // Initialize socket if necessary
+    if (!initialized_) {
+        if (!init())
+            return;
+    }
+
+    // If already running, do nothing
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true))
+        return;
+
+    batchCallback_ = std::move(callback);
+    batch_.reserve(receiveBatchLimit_);
+    thread_ = std::thread(&ZeroMQSubscriber::runLoop, this);
+}
+
+// setReceiveBatchLimit()
+// - Most messages read per wakeup; ignored while receiving
+void ZeroMQSubscriber::setReceiveBatchLimit(size_t maxMessages)
+{
+    if (running_.load() || maxMessages == 0)
+        return;
+    receiveBatchLimit_ = maxMessages;
+}
+
+// rejectedFrames()
+// - Number of payloads dropped by the integrity / decoding checks in runLoop()
+uint64_t ZeroMQSubscriber::rejectedFrames() const
+{
+    return rejectedFrames_.load(std::memory_order_relaxed);
+}
+
+// callbackErrors()
+// - Number of exceptions the callbacks threw, see runCallback()
+uint64_t ZeroMQSubscriber::callbackErrors() const
+{
+    return callbackErrors_.load(std::memory_order_relaxed);
+}
+
+// setWorkerThreads()
+// - Attaches the worker pool callbacks run on; ignored while receiving
+void ZeroMQSubscriber::setWorkerThreads(size_t workers)
+{
+    if (running_.load())
+        return;
+    shards_.reset();
+    executor_ = std::make_unique<WorkStealingExecutor<CallbackTask>>(workers,
+        [this](CallbackTask& task) { invokeCallback(*task.topic, task.payload); });
+}
+
+// setOrderedShards()
+// - Attaches the shard threads callbacks run on, replacing a worker pool; ignored while receiving
+void ZeroMQSubscriber::setOrderedShards(size_t shards, ShardKey key)
+{
+    if (running_.load())
+        return;
+    executor_.reset();
+    shardKey_ = key;
+    shards_ = std::make_unique<ShardedDispatcher<CallbackTask>>(shards,
+        [this](CallbackTask& task) { invokeCallback(*task.topic, task.payload); });
+}
+
+std::vector<ShardStats> ZeroMQSubscriber::shardStats() const
+{
+    return shards_ ? shards_->stats() : std::vector<ShardStats>{};
+}
+
+// shardKeyOf()
+// - Hash of what orders a message: its topic, or the sending app's ID for
+//   ShardKey::AppId (request topics and payload types without an appId fall
+//   back to the topic)
+uint64_t ZeroMQSubscriber::shardKeyOf(std::string_view topic, const CallbackPayload& payload) const
+{
+    std::string_view key = topic;
+    if (shardKey_ == ShardKey::AppId) {
+        // every payload type with an appId keys on it, whatever form it arrives in
+        auto appIdOf = [&key](const auto& message) {
+            if constexpr (requires { std::string_view(message.appId); })
+                key = message.appId;
+            else if constexpr (requires { message.appId(); })
+                key = message.appId();
         };
+        std::visit([&appIdOf](const auto& held) {
+            if constexpr (std::is_same_v<std::decay_t<decltype(held)>, MessagePtr>) {
+                if (held)
+                    visitMessage(*held, appIdOf);
+            }
+            else {
+                std::visit(appIdOf, held);
+            }
+        }, payload);
+    }
+    return std::hash<std::string_view>{}(key);
+}
+
+WorkStealingStats ZeroMQSubscriber::workerStats() const
+{
+    return executor_ ? executor_->stats() : WorkStealingStats{ 0, 0 };
+}
+
+// addSubscription() / removeSubscription()
+// - Update the filter list; on a live socket the change goes to the run loop as a
+//   command, since only the loop thread may touch socket_ once it runs
+void ZeroMQSubscriber::addSubscription(const std::string& topic)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (std::find(topicFilters_.begin(), topicFilters_.end(), topic) == topicFilters_.end())
+        topicFilters_.push_back(topic);
+    if (initialized_)
+        sendCommand(ControlCommand::Subscribe, topic);
+}
+
+void ZeroMQSubscriber::removeSubscription(const std::string& topic)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = std::find(topicFilters_.begin(), topicFilters_.end(), topic);
+    if (it == topicFilters_.end())
+        return;
+    topicFilters_.erase(it);
+    if (initialized_)
+        sendCommand(ControlCommand::Unsubscribe, topic);
+}
+
+// stop()
+// - Signals the background thread to stop and joins it
+void ZeroMQSubscriber::stop()
+{
+    bool expected = true;
+    if (!running_.compare_exchange_strong(expected, false))
+        return;
+
+    // wake the loop out of poll right away
+    sendCommand(ControlCommand::Stop);
+
+    if (thread_.joinable())
+        thread_.join();
+
+    // let the workers finish what was already received before the callbacks go
+    if (executor_)
+        executor_->waitIdle();
+    if (shards_)
+        shards_->waitIdle();
+
+    // Clear callbacks after stopping
+    callback_ = nullptr;
+    viewCallback_ = nullptr;
+    valueCallback_ = nullptr;
+    batchCallback_ = nullptr;
+}
+
+// close()
+// - Close and release the socket and reset state
+void ZeroMQSubscriber::close()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop();
+
+    if (socket_) {
+        try {
+            socket_->close();
+        }
+        catch (const zmq::error_t& e) {
+            std::cerr << "ZeroMQSubscriber close socket error: " << e.what() << "\n";
+        }
+        socket_.reset();
+    }
+    receiveState_ = ReceiveState::Topic;
+    controlSocket_.reset();
+    {
+        std::lock_guard<std::mutex> commandLock(commandMutex_);
+        commandSocket_.reset();
+    }
+    initialized_ = false;
+}
+
+// runLoop()
+// - Background loop that receives multipart messages (topic + message) or
+//   single-frame envelopes (see ZeroMQPublisher::setEnvelopeEnabled)
+// - Sleeps in zmq::poll on the data socket and the control socket with no timeout:
+//   an idle subscriber never wakes, and stop() / subscription changes arrive as
+//   commands that wake it immediately
+void ZeroMQSubscriber::runLoop()
+{
+    zmq::pollitem_t items[] = {
+        { socket_->handle(), 0, ZMQ_POLLIN, 0 },
+        { controlSocket_->handle(), 0, ZMQ_POLLIN, 0 },
+    };
+
+    while (running_.load()) {
+        try {
+            // no timeout: the thread sleeps until a frame or a command arrives
+            zmq::poll(items, 2, std::chrono::milliseconds(-1));
+
+            if (items[1].revents & ZMQ_POLLIN)
+                handleCommands();
+            if ((items[0].revents & ZMQ_POLLIN) && running_.load())
+                receiveBatch();
+        }
+        catch (const zmq::error_t& e) {
+            // EINTR: a signal interrupted poll, just poll again
+            if (e.num() == EINTR) {
+                continue;
+            }
+            std::cerr << "ZeroMQSubscriber receive error: " << e.what() << "\n";
+            // In case of other errors, give a small pause to avoid busy-looping
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+}
 
-    size_t appId_size;
-    read_raw(&appId_size, sizeof(appId_size));
+// receiveBatch()
+// - Called when poll reports the data socket readable: drains what is already
+//   queued, up to receiveBatchLimit_ messages, so one wakeup covers a burst,
+//   then hands a startBatches() callback everything in one call
+void ZeroMQSubscriber::receiveBatch()
+{
+    // bad payloads and callback exceptions are dealt with per message further
+    // down (decodeFrame / runCallback), so one of them does not end the batch
+    for (size_t received = 0; received < receiveBatchLimit_ && running_.load(); ++received) {
+        if (!receiveMessage())
+            break;
+    }
+    flushBatch();
+}
+
+// flushBatch()
+// - Hands the messages collected for startBatches() to its callback
+void ZeroMQSubscriber::flushBatch()
+{
+    if (batchCount_ == 0)
+        return;
+    std::span<ReceivedMessage> batch(batch_.data(), batchCount_);
+    batchCount_ = 0;
+    if (batchCallback_)
+        runCallback(callbackErrors_, [&]() { batchCallback_(batch); });
+}
 
-    message.appId.assign(ptr, appId_size);
-    ptr += appId_size;
+// handleCommands()
+// - Applies every queued control command; runs on the loop thread, which owns socket_
+void ZeroMQSubscriber::handleCommands()
+{
+    zmq::message_t command;
+    while (controlSocket_->recv(command, zmq::recv_flags::dontwait)) {
+        if (command.size() == 0)
+            continue;
+        const char* data = static_cast<const char*>(command.data());
+        std::string topic(data + 1, command.size() - 1);
+        switch (static_cast<ControlCommand>(data[0])) {
+        case ControlCommand::Subscribe:
+            socket_->set(zmq::sockopt::subscribe, topic);
+            socket_->set(zmq::sockopt::subscribe, readinessMarker(topic, subscriberId_));
+            break;
+        case ControlCommand::Unsubscribe:
+            socket_->set(zmq::sockopt::unsubscribe, topic);
+            socket_->set(zmq::sockopt::unsubscribe, readinessMarker(topic, subscriberId_));
+            break;
+        case ControlCommand::Stop:
+            // running_ is already false, the command only wakes poll
+            return;
+        }
+    }
+}
 
-    size_t appHealth_size;
-    read_raw(&appHealth_size, sizeof(appHealth_size));
+// sendCommand()
+// - Hands a command to the loop thread; any thread
+void ZeroMQSubscriber::sendCommand(ControlCommand command, const std::string& topic)
+{
+    std::lock_guard<std::mutex> lock(commandMutex_);
+    if (!commandSocket_)
+        return;
+    zmq::message_t frame(topic.size() + 1);
+    char* data = static_cast<char*>(frame.data());
+    data[0] = static_cast<char>(command);
+    std::memcpy(data + 1, topic.data(), topic.size());
+    try {
+        commandSocket_->send(frame, zmq::send_flags::none);
+    }
+    catch (const zmq::error_t& e) {
+        std::cerr << "ZeroMQSubscriber command error: " << e.what() << "\n";
+    }
+}
 
-    message.appHealth.assign(ptr, appHealth_size);
-    ptr += appHealth_size;
+// receiveMessage()
+// - Frame-accurate receive driven by ZMQ_RCVMORE: a message is dispatched as soon
+//   as its last frame (one without RCVMORE) arrives, and never waits for a frame
+//   that is not part of it. Shapes on the wire:
+//   - [topic]                          request topic, no payload
+//   - [topic][0x00][type id][payload]  single-frame envelope
+//   - [topic] + [payload]              multipart message
+//   Anything longer is discarded up to its last frame.
+// - libzmq delivers the frames of a message together, so the loop normally ends
+//   with a whole message; receiveState_ carries a partial one over to the next
+//   poll wake otherwise.
+// - Returns true once a whole message was handled, false when no frame is queued.
+bool ZeroMQSubscriber::receiveMessage()
+{
+    zmq::message_t frame;
+    while (socket_->recv(frame, zmq::recv_flags::dontwait)) {
+        bool more = frame.more();
+        switch (receiveState_) {
+        case ReceiveState::Topic:
+            if (more) {
+                topicFrame_ = std::move(frame);
+                receiveState_ = ReceiveState::Payload;
+                break;
+            }
+            dispatchSingleFrame(frame);
+            return true;
+
+        case ReceiveState::Payload:
+            if (more) {
+                // a third frame: not a message this subscriber understands
+                rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+                receiveState_ = ReceiveState::Discard;
+                break;
+            }
+            receiveState_ = ReceiveState::Topic;
+            {
+                // topic stays a view over the received frame; the owning callback path
+                // copies it into topic_, which keeps its capacity between messages
+                std::string_view topic(static_cast<const char*>(topicFrame_.data()), topicFrame_.size());
+                dispatchPayload(topic, topics_.find(topic), frame, 0, MessageTypeId::None);
+            }
+            return true;
 
-    read_raw(&message.numberToMultiply, sizeof(message.numberToMultiply));
+        case ReceiveState::Discard:
+            if (!more) {
+                receiveState_ = ReceiveState::Topic;
+                return true;
+            }
+            break;
+        }
+    }
+    return false;
+}
 
-    return message;
+// dispatchSingleFrame()
+// - A message that arrived as one frame: an envelope or a payload-less request topic
+void ZeroMQSubscriber::dispatchSingleFrame(zmq::message_t& frame)
+{
+    // topics never contain '\0', so a NUL in the frame marks a
+    // single-frame envelope: [topic][0x00][type id][payload]
+    const char* first = static_cast<const char*>(frame.data());
+    const char* separator = static_cast<const char*>(std::memchr(first, '\0', frame.size()));
+
+    if (!separator) {
+        // if topic was a request for data from other services, there is no payload frame
+        std::string_view topic(first, frame.size());
+        const TopicRoute* route = topics_.find(topic);
+        if (route && route->kind == TopicKind::Request)
+        {
+            if (viewCallback_)
+                deliverCallback(topic, route, MessageViewVariant{});
+            else if (valueCallback_)
+                deliverCallback(topic, route, MessageVariant{});
+            else if (callback_)
+                deliverCallback(topic, route, MessagePtr());
+            else if (batchCallback_)
+                appendToBatch(topic, MessageVariant{});
+        }
+        return;
+    }
 
+    size_t offset = static_cast<size_t>(separator - first) + 2; // where the payload starts
+    if (offset > frame.size()) {
+        rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    // the frame is handed on to the decoders, so its topic is copied into topic_ first
+    std::string_view topic = topic_.assign(first, separator - first);
+    MessageTypeId envelopeTypeId = static_cast<MessageTypeId>(static_cast<uint8_t>(separator[1]));
+    dispatchPayload(topic, topics_.find(topic), frame, offset, envelopeTypeId);
 }
 
-//p.s. still ugly, going to need to work on how to organize topics, this does not scale well 
-std::string ZeroMQSubscriber::determineRequestOrResponse(const std::string& topic) 
+// dispatchPayload()
+// - Verifies, decompresses and decodes the payload starting at offset in msg and
+//   hands it to the typed route or the start() / startViews() / startValues() callback
+void ZeroMQSubscriber::dispatchPayload(std::string_view topic, const TopicRoute* route, zmq::message_t& msg,
+    size_t offset, MessageTypeId envelopeTypeId)
 {
-    //if the topic is a request data topic, then output a string saying request
-    //else if the topic is a reponse topic, then determine what data is being sent back,
-    // and spit out that string type
+    // undo frame level transforms before anything looks at the payload:
+    // the checksum covers the frame as sent, so it is verified first. The frame
+    // is not modified; the decoders are told which flags were handled instead.
+    const char* payload = static_cast<const char*>(msg.data()) + offset;
+    size_t payloadSize = msg.size() - offset;
+    uint8_t flags = MessageCodec::peekFlags(payload, payloadSize);
+    uint8_t handledFlags = 0;
+    if (flags & MessageCodec::kFlagChecksum) {
+        if (!verifyChecksum(payload, payloadSize)) {
+            rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "ZeroMQSubscriber dropped payload with bad checksum on " << topic << "\n";
+            return;
+        }
+        handledFlags |= MessageCodec::kFlagChecksum;
+    }
+    if (flags & MessageCodec::kFlagCompressed) {
+        zmq::message_t plain;
+        if (!decompressPayload(payload, payloadSize, plain)) {
+            rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "ZeroMQSubscriber dropped malformed compressed payload on " << topic << "\n";
+            return;
+        }
+        msg = std::move(plain);
+        offset = 0;
+        payload = static_cast<const char*>(msg.data());
+        payloadSize = msg.size();
+        handledFlags = 0; // plain is our own copy, its flags are already cleared
+    }
+
+    // unpacking the topic to be used and determining payload to be deserialized
+    // the compact header carries the payload type ID; legacy frames carry none,
+    // so fall back to the envelope's type ID, then to what the topic says
+    MessageTypeId typeId = MessageCodec::peekTypeId(payload, payloadSize);
+    if (typeId == MessageTypeId::None)
+        typeId = envelopeTypeId;
+
+    // typed subscribe<T>() routes know their type; a frame that names a
+    // different one is rejected rather than decoded as garbage
+    if (route && route->handler >= 0) {
+        const TypedRoute& typed = routes_[route->handler];
+        if (typeId != MessageTypeId::None && typeId != typed.typeId) {
+            rejectedFrames_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!decodeFrame(topic, rejectedFrames_, [&]() { typed.decode(typed.state.get(), payload, payloadSize, handledFlags); }))
+            return;
+        runCallback(callbackErrors_, [&]() { typed.handle(typed.state.get(), topic_.assign(topic.data(), topic.size())); });
+        return;
+    }
 
-    std::string natureOfMessage = {};
+    if (typeId == MessageTypeId::None && route && route->kind == TopicKind::Response)
+        typeId = route->typeId;
+    size_t typeIndex = static_cast<size_t>(typeId);
+    if (typeIndex == 0 || typeIndex >= kMessageTypeCount) {
+        // not a payload we know how to decode
+        return;
+    }
 
-    if (topic == "statusRequestFrom1" || topic == "statusRequestFrom2" || topic == "statusRequestFrom3" ||
-        topic == "additionRequestFrom1" || topic == "additionRequestFrom2" || topic == "additionRequestFrom3" ||
-        topic == "multiplicationRequestFrom1" || topic == "multiplicationRequestFrom2" || topic == "multiplicationRequestFrom3")
+    // invoking callback to pop out of loop and send the topic / payload to App
+    // context: these are reply's to requests from apps
+    // one indexed call picks the decoder, no string compares per payload type;
+    // only the decoder runs under decodeFrame(), the callbacks are not its concern
+    if (viewCallback_)
     {
-        natureOfMessage =  "response";
+        // zero-copy path: the frame is moved into the view, nothing is decoded
+        MessageViewVariant view;
+        if (decodeFrame(topic, rejectedFrames_, [&]() { view = kViewDecoders[typeIndex](std::move(msg), offset, handledFlags); }))
+            deliverCallback(topic, route, std::move(view));
     }
-    else
+    else if (valueCallback_ || batchCallback_)
     {
-        //if receiving a status object 
-        if (topic == "statusResponseTo1" || topic == "statusResponseTo2" || topic == "statusResponseTo3")
-        {
-            natureOfMessage = "statusRequest";
+        MessageVariant value;
+        if (!decodeFrame(topic, rejectedFrames_, [&]() { value = kValueDecoders[typeIndex](payload, payloadSize, handledFlags); }))
+            return;
+        if (valueCallback_)
+            deliverCallback(topic, route, std::move(value));
+        else
+            appendToBatch(topic, std::move(value));
+    }
+    else if (callback_)
+    {
+        MessagePtr message;
+        if (decodeFrame(topic, rejectedFrames_, [&]() { message = kOwnedDecoders[typeIndex](payload, payloadSize, handledFlags); }))
+            deliverCallback(topic, route, std::move(message));
+    }
+    // Invoke callback outside of any locks to avoid deadlocks, pulls me out of loop
+    /*  old mech
+    if (callback_) {
+        callback_(topic, msg.data());
+    }
+    */
+}
+
+// appendToBatch()
+// - Adds a message to the batch for startBatches(); slots are reused between
+//   batches, so their topic strings keep their capacity
+void ZeroMQSubscriber::appendToBatch(std::string_view topic, MessageVariant&& message)
+{
+    if (batchCount_ == batch_.size())
+        batch_.emplace_back();
+    ReceivedMessage& slot = batch_[batchCount_++];
+    slot.topic.assign(topic.data(), topic.size());
+    slot.message = std::move(message);
+}
+
+// deliverCallback()
+// - Runs the callback here on the receive thread, or queues the decoded message
+//   for the worker pool / shard threads setWorkerThreads() / setOrderedShards() attached
+void ZeroMQSubscriber::deliverCallback(std::string_view topic, const TopicRoute* route, CallbackPayload&& payload)
+{
+    if (executor_) {
+        executor_->submit(makeCallbackTask(topic, route, std::move(payload)));
+        return;
+    }
+    if (shards_) {
+        uint64_t key = shardKeyOf(topic, payload);
+        shards_->submit(key, makeCallbackTask(topic, route, std::move(payload)));
+        return;
+    }
+    if (MessageViewVariant* view = std::get_if<MessageViewVariant>(&payload)) {
+        // the view callback takes the topic as a view, no copy needed
+        runCallback(callbackErrors_, [&]() { viewCallback_(topic, std::move(*view)); });
+        return;
+    }
+    invokeCallback(topic_.assign(topic.data(), topic.size()), payload);
+}
+
+// makeCallbackTask()
+// - A registry topic goes into the task by reference; others are copied into a
+//   recycled string
+ZeroMQSubscriber::CallbackTask ZeroMQSubscriber::makeCallbackTask(std::string_view topic, const TopicRoute* route,
+    CallbackPayload&& payload)
+{
+    CallbackTask task;
+    if (route) {
+        task.topic = &route->topic;
+    }
+    else {
+        task.ownedTopic.reset(TopicStringPool::shared().acquire());
+        task.ownedTopic->assign(topic.data(), topic.size());
+        task.topic = task.ownedTopic.get();
+    }
+    task.payload = std::move(payload);
+    return task;
+}
+
+void ZeroMQSubscriber::TopicRecycler::operator()(std::string* topic) const
+{
+    TopicStringPool::shared().recycle(topic);
+}
+
+// invokeCallback()
+// - Calls the callback matching the payload; receive thread or a worker thread
+// - An exception from the callback is counted by runCallback() and goes no further
+void ZeroMQSubscriber::invokeCallback(const std::string& topic, CallbackPayload& payload)
+{
+    runCallback(callbackErrors_, [&]() {
+        if (MessagePtr* message = std::get_if<MessagePtr>(&payload)) {
+            if (callback_)
+                callback_(topic, std::move(*message));
         }
-        //if receiving a data object (either for addition or multiplication in this case)
-        else if (topic == "additionResponseTo1" || topic == "additionResponseTo2" || topic == "additionResponseTo3")
-        {
-            natureOfMessage = "additionRequest";
+        else if (MessageVariant* value = std::get_if<MessageVariant>(&payload)) {
+            if (valueCallback_)
+                valueCallback_(topic, std::move(*value));
         }
-        else if (topic == "multiplicationReponseTo1" || topic == "multiplicationReponseTo2" || topic == "multiplicationReponseTo3")
-        {
-            natureOfMessage = "multiplicationRequest";
+        else if (MessageViewVariant* view = std::get_if<MessageViewVariant>(&payload)) {
+            if (viewCallback_)
+                viewCallback_(topic, std::move(*view));
         }
+    });
+}
+
+// determineRequestOrResponse()
+// - Kept for callers of the old string classification; answered from the topic registry
+std::string_view ZeroMQSubscriber::determineRequestOrResponse(std::string_view topic) 
+{
+    const TopicRoute* route = topics_.find(topic);
+    if (!route)
+        return {};
+    if (route->kind == TopicKind::Request)
+        return "response";
+    switch (route->typeId) {
+    case MessageTypeId::AppStatus:
+        return "statusRequest";
+    case MessageTypeId::AppDataRequest1:
+        return "additionRequest";
+    case MessageTypeId::AppDataRequest2:
+        return "multiplicationRequest";
+    default:
+        return {};
     }
-    return natureOfMessage;
 }
\ No newline at end of file
@@ -4,56 +4,453 @@
 #include <string>
 #include <memory>
 #include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <thread>
 #include <atomic>
 #include <vector>
 #include <cerrno>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+#include <chrono>
+#include <deque>
+#include <span>
+#include <utility>
+#include <variant>
 #include "iostream"
 #include "Messages.h"
+#include "MessageSchema.h"
+#include "MessagePool.h"
+#include "LzCompressor.h"
+#include "Crc32c.h"
+#include "MpscRing.h"
+#include "SendBufferPool.h"
+#include "ZmqContext.h"
+#include "TopicRegistry.h"
+#include "WorkStealingExecutor.h"
+#include "ShardedDispatcher.h"
 
 // Forward include for cppzmq
 #define ZMQ_BUILD_DRAFT_API
 #include <zmq.hpp>
+#include "MessageView.h"
 
 
+// Readiness markers. Next to every topic filter a subscriber also subscribes
+// [filter][0x00][0xFF][subscriber id]. No message ever starts with it (an
+// envelope type ID after the NUL is far below 0xFF), so it delivers nothing, but
+// unlike the filter itself it is unique per subscriber: the proxy forwards and
+// replays it even when another subscriber already holds the same filter, which
+// lets a publisher count the subscribers of a topic.
+inline constexpr std::string_view kReadinessMarkerTag{ "\0\xff", 2 };
+
+inline std::string readinessMarker(const std::string& filter, const std::string& subscriberId)
+{
+    std::string marker;
+    marker.reserve(filter.size() + kReadinessMarkerTag.size() + subscriberId.size());
+    marker.append(filter).append(kReadinessMarkerTag).append(subscriberId);
+    return marker;
+}
+
 class ZeroMQPublisher
 {
 public:
     // bindAddress example: "tcp://*:5556"
-    explicit ZeroMQPublisher(const std::string& connectAddress = ""); // empty to be specified upon declaration
+    // context: null shares the process-wide ZmqContext::shared()
+    explicit ZeroMQPublisher(const std::string& connectAddress = "", // empty to be specified upon declaration
+        std::shared_ptr<zmq::context_t> context = nullptr);
     ~ZeroMQPublisher();
 
-    // Initialize and bind the publisher socket. Returns true on success.
+    // Initialize and connect the publisher socket. Returns true on success.
+    // Instead of sleeping for a fixed time, init() waits until the subscriptions
+    // set by setReadiness() have reached the socket (see waitForSubscribers()),
+    // and returns early once they have. Without a match it returns after the
+    // readiness timeout, like the old fixed delay.
     bool init();
 
     // Publish a message under a topic, message can be any type as defined in Messages.h.
     // Returns true on success, false on failure.
-    // Calls serialize() to encode the payload if necessary
-    // OVERLOAD PUBLISH FOR EACH STRUCT TYPE
+    // publish(topic) sends a bare request topic without payload.
     bool publish(const std::string& topic);
-    bool publish(const std::string& topic, const AppStatus& message);
-    bool publish(const std::string& topic, const AppDataRequest1& message);
-    bool publish(const std::string& topic, const AppDataRequest2& message);
+
+    // Any type with a MessageSchema descriptor and a kTypeId can be published; the
+    // encoder is generated from the descriptor at compile time, so a new struct
+    // needs no new overload here. It does need its MessageTypeId, its place in
+    // MessageVariant and its schema entry (see Messages.h); the subscriber's
+    // decoder tables and views are generated from MessageVariant.
+    template<SchemaMessage T>
+    bool publish(const std::string& topic, const T& message);
+
+    // the original overloads, kept as thin instantiations of publish<T>
+    bool publish(const std::string& topic, const AppStatus& message) { return publish<AppStatus>(topic, message); }
+    bool publish(const std::string& topic, const AppDataRequest1& message) { return publish<AppDataRequest1>(topic, message); }
+    bool publish(const std::string& topic, const AppDataRequest2& message) { return publish<AppDataRequest2>(topic, message); }
+
+    // Publish many messages under a single lock (none in asynchronous mode), e.g.
+    // when answering a burst of requests. std::monostate items are sent as bare request topics. A message
+    // that cannot be delivered is counted like a failed publish() (see
+    // backpressureStats / sendQueueStats) and the rest are still sent; returns
+    // how many messages went out.
+    using PublishItem = std::pair<std::string, MessageVariant>;
+    size_t publishBatch(std::span<const PublishItem> items);
+
+    // Collects messages and hands them to publishBatch() together. The batch is
+    // flushed once it holds maxMessages, once its oldest pending message is
+    // maxLatency old, on flush() and when the Batch is destroyed. The deadline is
+    // kept by the publisher's batch timer thread (started with the first Batch),
+    // so a message added just before the owner goes idle still goes out in time;
+    // that flush runs on the timer thread. Pending items are overwritten in
+    // place, so a reused Batch stops allocating once it has seen its largest
+    // burst. Thread-safe; destroy every Batch before its publisher.
+    class Batch
+    {
+    public:
+        Batch(ZeroMQPublisher& publisher, size_t maxMessages = 64,
+            std::chrono::microseconds maxLatency = std::chrono::microseconds(500));
+        ~Batch();
+
+        Batch(const Batch&) = delete;
+        Batch& operator=(const Batch&) = delete;
+
+        void add(const std::string& topic);
+
+        // T is any MessageVariant alternative; the slot is assigned in place when
+        // it already holds a T, so its strings keep their capacity
+        template<SchemaMessage T>
+        void add(const std::string& topic, const T& message)
+        {
+            bool started;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                MessageVariant& slot = next(topic).second;
+                if (T* current = std::get_if<T>(&slot))
+                    *current = message;
+                else
+                    slot.template emplace<T>(message);
+                started = count_ == 1;
+            }
+            if (started)
+                publisher_.armBatchTimer();
+        }
+
+        // publish everything pending now; returns how many messages went out
+        size_t flush();
+
+        // flush() if the oldest pending message is older than maxLatency; the
+        // batch timer calls it, owners may too
+        size_t flushIfDue();
+
+        size_t pending() const;
+
+        // messages this Batch failed to deliver so far; what the destructor's
+        // flush fails to deliver only shows in the publisher's counters
+        size_t dropped() const;
+
+    private:
+        friend class ZeroMQPublisher;
+
+        // claims the next item slot, flushing first if the batch is full or stale
+        // (mutex_ held)
+        PublishItem& next(const std::string& topic);
+        size_t flushLocked();
+
+        ZeroMQPublisher& publisher_;
+        size_t maxMessages_;
+        std::chrono::microseconds maxLatency_;
+        mutable std::mutex mutex_;
+        std::vector<PublishItem> items_; // slots [0, count_) are pending
+        size_t count_;
+        size_t dropped_;
+        std::chrono::steady_clock::time_point oldest_;
+        // when the pending messages are due, read by the batch timer without
+        // mutex_; time_point::max() while nothing is pending
+        std::atomic<std::chrono::steady_clock::time_point> deadline_;
+    };
 
     // NOTE: technically, it is better to use ProtoBuffer or FlatBuffer to serialize
     //       rather than doing it by hand, but I don't want to have to download one
     //       more library and frustrate IT and prolong this project.
-    //       overloaded for each struct/message type. writes and packs all data members
+    //       MessageSchema.h holds one field descriptor per struct instead.
+
+    // Select the payload encoding. Defaults to WireFormat::Compact; use
+    // WireFormat::Legacy while subscribers built before the compact format are
+    // still running (subscribers detect the format per frame).
+    void setWireFormat(WireFormat format);
+
+    // Compact payloads larger than the threshold (in bytes) are LZ compressed and
+    // flagged in their header; subscribers decompress transparently. Compression is
+    // only kept when it actually shrinks the frame. kNoCompression turns it off.
+    // The per-topic overload overrides the default threshold for one topic.
+    static constexpr size_t kNoCompression = SIZE_MAX;
+    static constexpr size_t kDefaultCompressionThreshold = 512;
+    void setCompressionThreshold(size_t bytes);
+    void setCompressionThreshold(const std::string& topic, size_t bytes);
+
+    // Running totals for tuning the thresholds: ratio = bytesIn / bytesOut,
+    // CPU cost per MB = nanoseconds / (bytesIn / 1e6).
+    struct CompressionStats
+    {
+        uint64_t framesCompressed; // sent compressed
+        uint64_t framesSkipped;    // above the threshold but compression did not pay off
+        uint64_t bytesIn;          // payload bytes fed to the compressor
+        uint64_t bytesOut;         // bytes sent for those payloads
+        uint64_t nanoseconds;      // time spent compressing
+    };
+    CompressionStats compressionStats() const;
 
-    std::string serialize(const AppStatus& message);
-    std::string serialize(const AppDataRequest1& message);
-    std::string serialize(const AppDataRequest2& message);
+    // Append a CRC32C trailer to every compact payload so subscribers can reject
+    // corrupted frames instead of decoding garbage. Off by default; subscribers
+    // accept frames with and without the trailer.
+    void setChecksumEnabled(bool enabled);
+
+    // Send topic and payload as a single frame, [topic][0x00][type id][payload],
+    // instead of a topic frame followed by a payload frame. The topic stays a
+    // prefix of the frame, so subscription filtering is unaffected; subscribers
+    // recognise the layout per message. Halves the socket operations per message,
+    // which dominate for small payloads. Topics must not contain '\0'.
+    void setEnvelopeEnabled(bool enabled);
+
+    // Readiness handshake. The socket is an XPUB, so it receives the subscriptions
+    // the proxy forwards from its subscribers, including their readiness markers
+    // (see readinessMarker()). waitForSubscribers() returns true as soon as every
+    // topic in topics is covered by the filters of at least subscribersPerTopic
+    // distinct subscribers (a subscribed prefix covers all topics starting with
+    // it), or false after timeout. A plain subscription without markers counts as
+    // one subscriber. With no
+    // topics, any subscription counts: that only proves the path through the
+    // proxy is live, not that the subscribers of a given topic have joined, so
+    // pass the topics you are about to publish. init() waits on the setReadiness()
+    // topics and returns true even if the timeout expires.
+    // The handshake is best-effort: subscribers that join later, or never, are
+    // not waited for and miss whatever was published before they joined. Later
+    // subscription events are still consumed while sending, so they do not pile
+    // up in the socket. Call waitForSubscribers() before startAsync(), it reads
+    // from the socket. Services should init() their subscriber first, so peers
+    // starting at the same time find each other instead of all timing out.
+    static constexpr std::chrono::milliseconds kDefaultReadyTimeout{ 100 };
+    void setReadiness(const std::vector<std::string>& topics,
+        std::chrono::milliseconds timeout = kDefaultReadyTimeout, int subscribersPerTopic = 1);
+    bool waitForSubscribers(const std::vector<std::string>& topics, std::chrono::milliseconds timeout,
+        int subscribersPerTopic = 1);
+
+    // Asynchronous mode: publish() encodes the message on the caller's thread and
+    // pushes the finished frames into a bounded lock-free queue; a dedicated I/O
+    // thread drains the queue into the socket. Callers never wait on the socket
+    // and never take the publisher's mutex, so concurrent publishers encode and
+    // enqueue in parallel. While the queue is full publish() returns false and the
+    // message is counted as rejected. stopAsync() waits for the publish() calls
+    // already on the queue path, sends what is still queued and joins the thread;
+    // a publish() racing with it is either drained or sent synchronously.
+    static constexpr size_t kDefaultSendQueueCapacity = 4096;
+    bool startAsync(size_t queueCapacity = kDefaultSendQueueCapacity);
+    void stopAsync();
+
+    struct SendQueueStats
+    {
+        uint64_t sent;       // messages written to the socket (either mode)
+        uint64_t rejected;   // publish() calls that found the queue full
+        uint64_t sendErrors; // queued messages the socket refused
+    };
+    SendQueueStats sendQueueStats() const;
+
+    // What happens to a message when the socket's send high-water mark is reached.
+    // The socket is set to report a full queue instead of silently dropping
+    // (ZMQ_XPUB_NODROP), and the policy decides:
+    //  Block       wait up to blockTimeout for room, then drop; messages backlogged
+    //              under an earlier DropOldest / Conflate policy go out first
+    //  DropNewest  drop the message being published (default)
+    //  DropOldest  park it in a backlog that is retried before anything newer is
+    //              sent; when the backlog holds backlogLimit messages the oldest goes
+    //  Conflate    like DropOldest, but the backlog keeps only the newest message
+    //              per topic
+    // publish() returns false only for dropped messages. Backlogged messages are
+    // retried on the next publish (or by the I/O thread in asynchronous mode).
+    enum class BackpressurePolicy { Block, DropNewest, DropOldest, Conflate };
+    void setBackpressurePolicy(BackpressurePolicy policy,
+        std::chrono::milliseconds blockTimeout = std::chrono::milliseconds(100),
+        size_t backlogLimit = 1024);
+
+    // ZMQ_SNDHWM, in messages per subscriber connection (libzmq default: 1000).
+    // Applied by init(), so call it before the socket is created.
+    void setSendHighWaterMark(int messages);
+
+    struct BackpressureStats
+    {
+        uint64_t dropped; // messages lost to the policy (dropped or conflated away)
+        uint64_t delayed; // messages that found the socket full and waited or were backlogged
+        size_t backlog;   // messages currently backlogged
+    };
+    BackpressureStats backpressureStats() const;
 
     // Close the socket and context.
     void close();
 
 private:
+    // frames of one message on their way to the I/O thread: a topic frame plus a
+    // payload frame, or a single frame (request topic or envelope)
+    struct OutgoingMessage
+    {
+        zmq::message_t first;
+        zmq::message_t second;
+        bool multipart = false;
+    };
+
+    enum class SendResult { Sent, Deferred, Dropped };
+
+    // What publish() encodes with. The setters never modify a published version:
+    // they copy it, change the copy and swap the pointer, so a publish() reads one
+    // consistent snapshot without a lock. Old versions stay alive until the
+    // publisher is destroyed; the setters are configuration calls, not per message.
+    struct EncodeSettings
+    {
+        WireFormat wireFormat = WireFormat::Compact;
+        size_t compressionThreshold = kDefaultCompressionThreshold;
+        std::unordered_map<std::string, size_t> topicCompressionThresholds;
+        bool checksumEnabled = false;
+        bool envelopeEnabled = false;
+
+        size_t compressionThresholdFor(const std::string& topic) const;
+    };
+    const EncodeSettings& encodeSettings() const { return *settings_.load(std::memory_order_acquire); }
+    template<typename Change>
+    void changeSettings(Change&& change);
+
+    // A publish() on the lock-free asynchronous path. It counts itself in
+    // asyncProducers_ before checking asyncRunning_, and stopAsync() clears the
+    // flag before waiting for the count to drop to zero, so either the producer
+    // sees the queue closed or stopAsync() waits for its push.
+    class AsyncProducer
+    {
+    public:
+        explicit AsyncProducer(ZeroMQPublisher& publisher) : publisher_(publisher)
+        {
+            publisher_.asyncProducers_.fetch_add(1, std::memory_order_seq_cst);
+            active_ = publisher_.asyncRunning_.load(std::memory_order_seq_cst);
+        }
+        ~AsyncProducer() { publisher_.asyncProducers_.fetch_sub(1, std::memory_order_release); }
+
+        AsyncProducer(const AsyncProducer&) = delete;
+        AsyncProducer& operator=(const AsyncProducer&) = delete;
+
+        bool active() const { return active_; }
+
+    private:
+        ZeroMQPublisher& publisher_;
+        bool active_;
+    };
+
+    // hands a finished message to the I/O thread
+    bool enqueue(OutgoingMessage&& message);
+    // writes a message to the socket applying the backpressure policy; the caller
+    // owns the socket (mutex_ held, or the I/O thread)
+    SendResult transmit(OutgoingMessage& message);
+    // one send attempt; false if the high-water mark was hit (message left intact)
+    bool trySend(OutgoingMessage& message, bool wait);
+    // trySend() waiting at most timeoutMs; the socket's sndtimeo is back to
+    // blocking (-1) afterwards, so later sends are not affected
+    bool trySendWithin(OutgoingMessage& message, int timeoutMs);
+    // retries backlogged messages in order until the socket is full again
+    void flushBacklog();
+    static std::string_view topicOf(const OutgoingMessage& message);
+    void ioLoop();
+
+    // readiness helpers (mutex_ held): consume pending subscription events and
+    // check the expected topics against the subscriptions seen so far
+    bool waitForSubscribersLocked(const std::vector<std::string>& topics, std::chrono::milliseconds timeout,
+        int subscribersPerTopic);
+    bool subscribersReady(const std::vector<std::string>& topics, int subscribersPerTopic) const;
+    void applySubscriptionEvent(const zmq::message_t& event);
+    // a blocking recv bounded by timeoutMs; rcvtimeo is back to -1 afterwards
+    bool recvWithin(zmq::message_t& message, int timeoutMs);
+    // takes the subscription events queued on the socket without waiting; the
+    // caller owns the socket. transmit() calls it every kSubscriptionDrainInterval sends
+    void drainSubscriptionEvents();
+    static constexpr uint32_t kSubscriptionDrainInterval = 64;
+
+    // envelope bytes on top of the topic: the '\0' separator and the type id
+    static constexpr size_t kEnvelopePrefixExtra = 2;
+
+    // encodes the payload directly into a pre-sized zmq::message_t, with the
+    // envelope prefix, compression and checksum as configured; needs no lock
+    template<SchemaMessage T>
+    zmq::message_t encodePayload(const std::string& topic, const T& message, const EncodeSettings& settings);
+
+    // the frames of topic + payload (payload null for a bare request topic)
+    static OutgoingMessage makeOutgoing(const std::string& topic, zmq::message_t* payload, const EncodeSettings& settings);
+
+    // enqueues the message without a lock in asynchronous mode, otherwise sends
+    // it under mutex_ applying the backpressure policy
+    bool deliver(const std::string& topic, zmq::message_t* payload, const EncodeSettings& settings);
+    // the synchronous half of deliver() (mutex_ held); enqueues after all if
+    // startAsync() ran in the meantime
+    bool deliverLocked(OutgoingMessage&& outgoing);
+
+    // Batch deadlines: every Batch registers with its publisher, and one timer
+    // thread flushes those whose oldest message has waited maxLatency. Lock
+    // order is batchTimerMutex_, then a Batch's mutex, then mutex_.
+    void registerBatch(Batch* batch);
+    void unregisterBatch(Batch* batch);
+    // wakes the timer to pick up a Batch that just got its first message
+    void armBatchTimer();
+    void batchTimerLoop();
+    void stopBatchTimer();
+
+    // swaps payload for its compressed form when that is smaller; the first
+    // prefixSize bytes are the envelope prefix and are carried over, the last
+    // trailerSize bytes are reserved for the checksum. The compressor's scratch
+    // space is per thread, so no lock is needed
+    void compressPayload(zmq::message_t& payload, size_t prefixSize, size_t trailerSize);
+
     std::string connectAddress_; // using a proxy to connect, so we don't bind the pub, just connect
-    zmq::context_t context_;
+    std::shared_ptr<zmq::context_t> context_;
     std::unique_ptr<zmq::socket_t> socket_;
     std::mutex mutex_;
     bool initialized_;
+
+    std::atomic<const EncodeSettings*> settings_;
+    std::vector<std::unique_ptr<EncodeSettings>> settingsVersions_; // guarded by settingsMutex_
+    std::mutex settingsMutex_;
+
+    std::atomic<uint64_t> framesCompressed_;
+    std::atomic<uint64_t> framesSkipped_;
+    std::atomic<uint64_t> compressBytesIn_;
+    std::atomic<uint64_t> compressBytesOut_;
+    std::atomic<uint64_t> compressNanoseconds_;
+
+    std::unique_ptr<MpscRing<OutgoingMessage>> sendQueue_;
+    std::thread ioThread_;
+    std::mutex batchTimerMutex_;
+    std::condition_variable batchTimerWake_;
+    std::vector<Batch*> batches_; // guarded by batchTimerMutex_
+    std::thread batchTimerThread_;
+    bool batchTimerRunning_; // guarded by batchTimerMutex_
+
+    std::atomic<bool> asyncRunning_;
+    std::atomic<uint32_t> asyncProducers_; // publish() calls on the lock-free path, see AsyncProducer
+    std::atomic<bool> ioWaiting_;      // the I/O thread is (about to be) parked on ioWakeups_
+    std::atomic<uint32_t> ioWakeups_;  // bumped to wake the parked I/O thread
+    std::atomic<uint64_t> queueSent_;
+    std::atomic<uint64_t> queueRejected_;
+    std::atomic<uint64_t> queueSendErrors_;
+
+    std::atomic<BackpressurePolicy> backpressurePolicy_;
+    std::atomic<int> blockTimeoutMs_;
+    std::atomic<size_t> backlogLimit_;
+    int sendHighWaterMark_;
+    std::deque<OutgoingMessage> backlog_; // owned by whoever owns the socket
+    std::atomic<uint64_t> droppedMessages_;
+    std::atomic<uint64_t> delayedMessages_;
+    std::atomic<size_t> backlogSize_;
+
+    std::vector<std::string> readyTopics_;
+    std::chrono::milliseconds readyTimeout_;
+    int readySubscribers_;
+    std::unordered_set<std::string> subscriptions_; // plain subscribed prefixes
+    std::unordered_map<std::string, std::unordered_set<std::string>> subscribers_; // filter -> marker ids
+    bool subscriptionSeen_;
+    uint32_t sendsSinceDrain_; // owned by whoever owns the socket
 };
 
 // Simple ZeroMQ subscriber helper that receives messages on a background thread
@@ -62,8 +459,10 @@ class ZeroMQSubscriber
 public:
     // connectAddress example: "tcp://localhost:5556"
     // topicFilters example: empty vector subscribes to everything, or a list of topics to receive only those
+    // context: null shares the process-wide ZmqContext::shared()
     explicit ZeroMQSubscriber(const std::string& connectAddress = "", // empty to be specified upon declaration
-        const std::vector<std::string>& topicFilters = {});
+        const std::vector<std::string>& topicFilters = {},
+        std::shared_ptr<zmq::context_t> context = nullptr);
     ~ZeroMQSubscriber();
 
     // Initialize and connect the subscriber socket. Returns true on success.
@@ -71,39 +470,313 @@ public:
 
     // Start background receiving. The callback will be invoked for each message as (topic, message).
     // Overload to let callback return whatever type of struct got sent
-    void start(std::function<void(const std::string&, std::unique_ptr<Message>)>callback);
+    // Messages come from the per-type MessagePool: dropping the MessagePtr recycles the
+    // object, so under steady load receiving does not touch the heap.
+    void start(std::function<void(const std::string&, MessagePtr)>callback);
+
+    // Zero-copy alternative to start(): the callback receives the topic and a read-only
+    // view over the received payload frame (std::monostate for request topics).
+    // Nothing is allocated or copied between the socket and the callback; the topic
+    // view is only valid for the duration of the call.
+    using ViewCallback = std::function<void(std::string_view, MessageViewVariant)>;
+    void startViews(ViewCallback callback);
+
+    // Value alternative to start(): payloads arrive as a MessageVariant held inline
+    // (std::monostate for request topics) instead of a heap object behind a
+    // Message pointer, so they can be queued by value and handled with std::visit.
+    using ValueCallback = std::function<void(const std::string&, MessageVariant)>;
+    void startValues(ValueCallback callback);
+
+    // Batch alternative to startValues(): every message drained in one wakeup
+    // (see setReceiveBatchLimit) arrives in a single call as one contiguous span,
+    // so per-message callback, locking and queueing cost is paid once per burst.
+    // The span and its slots are reused for the next batch; move out what you keep.
+    // Runs on the receive thread, setWorkerThreads() / setOrderedShards() do not apply.
+    struct ReceivedMessage
+    {
+        std::string topic;
+        MessageVariant message; // std::monostate for request topics
+    };
+    using BatchCallback = std::function<void(std::span<ReceivedMessage>)>;
+    void startBatches(BatchCallback callback);
+
+    // Most messages the receive thread reads per wakeup before it polls the
+    // control socket again, and the largest batch startBatches() delivers.
+    // Call before starting.
+    static constexpr size_t kDefaultReceiveBatchLimit = 64;
+    void setReceiveBatchLimit(size_t maxMessages);
+
+    // Payload frames dropped because they failed the CRC32C check, could not be
+    // decompressed or decoded. Such frames are logged and skipped.
+    uint64_t rejectedFrames() const;
+
+    // Exceptions thrown by the callbacks / typed handlers. They are logged and
+    // counted here, not as rejected frames, and receiving carries on with the
+    // next message.
+    uint64_t callbackErrors() const;
+
+    // Typed subscription: handler receives every T published under exactly this
+    // topic. The decoder comes from MessageSchema<T> at compile time and each
+    // route decodes into its own cached T (strings keep their capacity), so the
+    // receive path neither allocates nor inspects types. A payload whose type ID
+    // says it is not a T is rejected. Routed topics bypass the start() /
+    // startViews() / startValues() callbacks.
+    // Register before init(); the topic is added to the filter list, so a
+    // subscriber created without filters then only receives its typed topics.
+    template<SchemaMessage T>
+    void subscribe(const std::string& topic, std::function<void(const std::string&, const T&)> handler)
+    {
+        auto state = std::make_shared<TypedHandler<T>>();
+        state->handler = std::move(handler);
+        routes_.push_back(TypedRoute{ topic, T::kTypeId, state, &ZeroMQSubscriber::decodeTyped<T>,
+            &ZeroMQSubscriber::handleTyped<T> });
+        topicFilters_.push_back(topic);
+    }
+
+    // Start background receiving for the subscribe<T>() routes only.
+    void start();
+
+    // Run the start() / startViews() / startValues() callback on a pool of worker
+    // threads (0 = one per hardware thread) with work stealing; the receive thread
+    // then only decodes and queues, so a slow callback no longer stops receiving.
+    // With more than one worker the callback must be thread-safe and messages can
+    // finish out of order. Call before start(); subscribe<T>() routes still run on
+    // the receive thread, they share one decode target per route.
+    void setWorkerThreads(size_t workers);
+    WorkStealingStats workerStats() const;
+
+    // What keeps messages in order under setOrderedShards()
+    enum class ShardKey
+    {
+        Topic, // successive messages on one topic
+        AppId  // successive messages from one app, whatever the topic
+    };
+
+    // Ordered alternative to setWorkerThreads(): each message goes to one of a
+    // fixed set of shard threads (0 = one per hardware thread) picked by hashing
+    // its key, so messages with the same key are handled one at a time in the
+    // order received while different keys run in parallel. The callback must be
+    // thread-safe for more than one shard. Call before start(); replaces a
+    // worker pool set earlier.
+    void setOrderedShards(size_t shards, ShardKey key = ShardKey::Topic);
+    // per shard queue depth (now and peak) and messages handled
+    std::vector<ShardStats> shardStats() const;
 
-    // Stop receiving and join the background thread.
+    // Add or remove a topic filter at any time. While running, the change is
+    // handed to the receive thread over the control socket and applied at once.
+    void addSubscription(const std::string& topic);
+    void removeSubscription(const std::string& topic);
+
+    // Stop receiving and join the background thread. The receive thread is woken
+    // through the control socket, so this returns without waiting on a timeout.
     void stop();
 
     // Close subscriber socket and context.
     void close();
 
    // deSerialize()
-    AppStatus deserializeStatus(const std::string& s);
-    AppDataRequest1 deserializeAddition(const std::string& s);
-    AppDataRequest2 deserializeMultiplication(const std::string& s);
+    // decodes a received payload frame using the type's MessageSchema descriptor
+    template<typename T>
+    static T deserialize(const zmq::message_t& payload)
+    {
+        return MessageCodec::decode<T>(payload.data(), payload.size());
+    }
+
+    // Registry entry for a topic: request or response, payload type and, for
+    // requests, the topic the answer goes out on. nullptr for unknown topics.
+    // The registry is rebuilt by init(), which adds the subscribe<T>() routes.
+    const TopicRoute* topicRoute(std::string_view topic) const;
 
     // helper function to make response or request logic in subscriber much clearer
-    // considers all available topics and boils down the rec'd ZeroMQ message to
-    // "this was a request from an app to other apps, and this was a response"
-    // still need to return a string if it was a response to acertain the struct object to send
-    std::string determineRequestOrResponse(const std::string& topic);
+    // boils down the rec'd ZeroMQ message to "this was a request from an app to
+    // other apps, and this was a response"; a thin wrapper over topicRoute()
+    // returns a view of a string literal so classifying a topic never allocates
+    std::string_view determineRequestOrResponse(std::string_view topic);
 
 private:
+    // one subscribe<T>() registration; decode and handle are the thunks for T,
+    // kept apart so a handler exception is not taken for a bad payload
+    struct TypedRoute
+    {
+        std::string topic;
+        MessageTypeId typeId;
+        std::shared_ptr<void> state;
+        void (*decode)(void* state, const char* payload, size_t size, uint8_t handledFlags);
+        void (*handle)(void* state, const std::string& topic);
+    };
+
+    template<SchemaMessage T>
+    struct TypedHandler
+    {
+        std::function<void(const std::string&, const T&)> handler;
+        T message; // decode target, reused for every payload on the route
+    };
+
+    template<SchemaMessage T>
+    static void decodeTyped(void* state, const char* payload, size_t size, uint8_t handledFlags)
+    {
+        TypedHandler<T>& typed = *static_cast<TypedHandler<T>*>(state);
+        MessageCodec::decode(payload, size, typed.message, handledFlags);
+    }
+
+    template<SchemaMessage T>
+    static void handleTyped(void* state, const std::string& topic)
+    {
+        TypedHandler<T>& typed = *static_cast<TypedHandler<T>*>(state);
+        typed.handler(topic, typed.message);
+    }
+
+    // control socket commands: one opcode byte followed by the topic, if any
+    enum class ControlCommand : char
+    {
+        Stop = 'S',
+        Subscribe = '+',
+        Unsubscribe = '-'
+    };
+
+    // where receiveMessage() is inside a multipart message
+    enum class ReceiveState
+    {
+        Topic,   // expecting the first frame of a message
+        Payload, // topic frame received, expecting the payload frame
+        Discard  // skipping the rest of a message with too many frames
+    };
+
     void runLoop();
+    bool receiveMessage();
+    void receiveBatch();
+    void flushBatch();
+    void appendToBatch(std::string_view topic, MessageVariant&& message);
+    void dispatchSingleFrame(zmq::message_t& frame);
+    void dispatchPayload(std::string_view topic, const TopicRoute* route, zmq::message_t& msg,
+        size_t offset, MessageTypeId envelopeTypeId);
+    void handleCommands();
+
+    // a decoded message on its way to the callback, possibly via a worker thread
+    using CallbackPayload = std::variant<MessagePtr, MessageVariant, MessageViewVariant>;
+
+    // topic storage for queued tasks whose topic is not in the registry; the
+    // strings are recycled with their capacity (see TopicStringPool in ZeroMQ.cpp)
+    struct TopicRecycler
+    {
+        void operator()(std::string* topic) const;
+    };
+    using PooledTopic = std::unique_ptr<std::string, TopicRecycler>;
+
+    struct CallbackTask
+    {
+        // A registry topic is referenced: the registry is only rebuilt by init(),
+        // and stop() lets the workers finish first. Any other topic is copied
+        // into ownedTopic, which topic then points to. Either way queuing a task
+        // does not allocate for its topic.
+        const std::string* topic = nullptr;
+        PooledTopic ownedTopic;
+        CallbackPayload payload;
+    };
+
+    // route: the registry entry of topic, or null
+    void deliverCallback(std::string_view topic, const TopicRoute* route, CallbackPayload&& payload);
+    CallbackTask makeCallbackTask(std::string_view topic, const TopicRoute* route, CallbackPayload&& payload);
+    void invokeCallback(const std::string& topic, CallbackPayload& payload);
+    uint64_t shardKeyOf(std::string_view topic, const CallbackPayload& payload) const;
+    void sendCommand(ControlCommand command, const std::string& topic = std::string());
 
     std::string connectAddress_;
     std::vector<std::string> topicFilters_;
-    zmq::context_t context_;
+    std::string subscriberId_; // readiness marker id, see readinessMarker()
+    std::shared_ptr<zmq::context_t> context_;
     std::unique_ptr<zmq::socket_t> socket_;
+    std::unique_ptr<zmq::socket_t> controlSocket_; // run loop end of the control pair
+    std::unique_ptr<zmq::socket_t> commandSocket_; // caller end, guarded by commandMutex_
+    std::mutex commandMutex_;
     std::mutex mutex_;
     bool initialized_;
 
-    std::function<void(const std::string&, std::unique_ptr<Message>)> callback_;
+    std::function<void(const std::string&, MessagePtr)> callback_;
+    ViewCallback viewCallback_;
+    ValueCallback valueCallback_;
+    BatchCallback batchCallback_;
+    std::vector<ReceivedMessage> batch_; // slots reused between batches
+    size_t batchCount_ = 0;              // slots filled in the current batch
+    size_t receiveBatchLimit_ = kDefaultReceiveBatchLimit;
     std::thread thread_;
     std::atomic<bool> running_;
+    std::string topic_; // reused for every received topic so its capacity is kept
+    ReceiveState receiveState_ = ReceiveState::Topic;
+    zmq::message_t topicFrame_; // topic frame of the multipart message being received
+    std::atomic<uint64_t> rejectedFrames_;
+    std::atomic<uint64_t> callbackErrors_;
+    std::vector<TypedRoute> routes_;
+    TopicRegistry topics_; // topic -> route, one hash probe per received message
+    // declared last: destroyed (workers joined) before the callbacks they call;
+    // at most one of executor_ / shards_ is set
+    std::unique_ptr<WorkStealingExecutor<CallbackTask>> executor_;
+    std::unique_ptr<ShardedDispatcher<CallbackTask>> shards_;
+    ShardKey shardKey_ = ShardKey::Topic;
 };
 
 
+// -------------------- Publisher template implementation --------------------
+
+// publish<T>(topic, message)
+// - Encodes on the caller's thread without a lock, then delivers: lock-free in
+//   asynchronous mode, under the publisher mutex otherwise
+template<SchemaMessage T>
+bool ZeroMQPublisher::publish(const std::string& topic, const T& message)
+{
+    // Ensure socket is initialized
+    if (!initialized_) {
+        if (!init())
+            return false;
+    }
+
+    const EncodeSettings& settings = encodeSettings();
+    try {
+        zmq::message_t payload = encodePayload(topic, message, settings);
+        return deliver(topic, &payload, settings);
+    }
+    catch (const zmq::error_t& e) {
+        std::cerr << "ZeroMQPublisher publish error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+// encodePayload(topic, message, settings)
+// - Sizes the payload frame exactly with MessageCodec::encodedSize and encodes
+//   the message straight into it (no stream, no intermediate std::string)
+// - The frame's buffer comes from SendBufferPool and goes back there once
+//   libzmq has sent it
+// - In envelope mode the frame is [topic][0x00][type id][payload]
+template<SchemaMessage T>
+zmq::message_t ZeroMQPublisher::encodePayload(const std::string& topic, const T& message, const EncodeSettings& settings)
+{
+    // room for the envelope prefix and the CRC32C trailer is reserved up front,
+    // the payload is encoded in between and the trailer is filled in last
+    const WireFormat format = settings.wireFormat;
+    const bool compact = format == WireFormat::Compact;
+    const size_t prefixSize = settings.envelopeEnabled ? topic.size() + kEnvelopePrefixExtra : 0;
+    const size_t trailerSize = (compact && settings.checksumEnabled) ? MessageCodec::kChecksumSize : 0;
+
+    zmq::message_t payload = SendBufferPool::shared().makeMessage(
+        prefixSize + MessageCodec::encodedSize(message, format) + trailerSize);
+    char* bytes = static_cast<char*>(payload.data());
+    if (prefixSize) {
+        std::memcpy(bytes, topic.data(), topic.size());
+        bytes[topic.size()] = '\0';
+        bytes[topic.size() + 1] = static_cast<char>(T::kTypeId);
+    }
+    MessageCodec::encode(message, bytes + prefixSize, format);
+
+    // only the compact header has room for the compression and checksum flags
+    if (compact && payload.size() - prefixSize - trailerSize > settings.compressionThresholdFor(topic))
+        compressPayload(payload, prefixSize, trailerSize);
 
+    if (trailerSize) {
+        // the checksum covers the header too, so a flipped flag or type ID is caught
+        char* header = static_cast<char*>(payload.data()) + prefixSize;
+        const size_t covered = payload.size() - prefixSize - trailerSize;
+        header[MessageCodec::kCompactFlagsOffset] |= MessageCodec::kFlagChecksum;
+        CompactWireFormat::writeScalar(header + covered, Crc32c::compute(header, covered));
+    }
+    return payload;
+}
@@ -0,0 +1,52 @@
+// Process-wide ZMQ context (see ZmqContext.h).
+
+#include "ZmqContext.h"
+
+#include <iostream>
+#include <mutex>
+
+namespace
+{
+    std::mutex contextMutex;
+    ZmqContextOptions sharedOptions;
+    std::shared_ptr<zmq::context_t> sharedContext;
+}
+
+bool ZmqContext::configure(const ZmqContextOptions& options)
+{
+    std::lock_guard<std::mutex> lock(contextMutex);
+    if (sharedContext)
+        return false;
+    sharedOptions = options;
+    return true;
+}
+
+std::shared_ptr<zmq::context_t> ZmqContext::shared()
+{
+    std::lock_guard<std::mutex> lock(contextMutex);
+    if (!sharedContext)
+        sharedContext = create(sharedOptions);
+    return sharedContext;
+}
+
+std::shared_ptr<zmq::context_t> ZmqContext::create(const ZmqContextOptions& options)
+{
+    auto context = std::make_shared<zmq::context_t>(options.ioThreads, options.maxSockets);
+    try {
+        // the thread options are read when libzmq starts its I/O threads, which
+        // happens with the first socket, so setting them here is early enough
+        if (options.schedPolicy >= 0)
+            context->set(zmq::ctxopt::thread_sched_policy, options.schedPolicy);
+        if (options.threadPriority >= 0)
+            context->set(zmq::ctxopt::thread_priority, options.threadPriority);
+#ifdef ZMQ_THREAD_AFFINITY_CPU_ADD
+        for (int cpu : options.affinityCpus)
+            context->set(zmq::ctxopt::thread_affinity_cpu_add, cpu);
+#endif
+    }
+    catch (const zmq::error_t& e) {
+        // an unsupported option leaves the context usable with OS defaults
+        std::cerr << "ZmqContext option error: " << e.what() << "\n";
+    }
+    return context;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#define ZMQ_BUILD_DRAFT_API
+#include <zmq.hpp>
+
+// Settings for a ZMQ context. They only take effect before the first socket is
+// created on the context.
+struct ZmqContextOptions
+{
+    int ioThreads = 1;              // ZMQ_IO_THREADS: background I/O threads
+    int maxSockets = 1023;          // ZMQ_MAX_SOCKETS
+    std::vector<int> affinityCpus;  // ZMQ_THREAD_AFFINITY_CPU_ADD per CPU; empty = no pinning
+    int schedPolicy = -1;           // ZMQ_THREAD_SCHED_POLICY (e.g. SCHED_FIFO); -1 = OS default
+    int threadPriority = -1;        // ZMQ_THREAD_PRIORITY, used with schedPolicy; -1 = OS default
+};
+// NOTE: libzmq applies affinity, scheduling policy and priority through pthreads;
+//       on Windows builds those three are accepted and ignored.
+
+// Process-wide ZMQ context shared by every ZeroMQPublisher / ZeroMQSubscriber that
+// is not given one explicitly. Sharing one context keeps a process at a known
+// number of I/O threads instead of one per socket wrapper, and lets the sockets of
+// one process talk over inproc://.
+// Each user holds a shared_ptr, so the context is terminated only after the last
+// socket wrapper using it is gone.
+class ZmqContext
+{
+public:
+    // Settings for the shared context. Returns false (and changes nothing) if the
+    // shared context has already been created; call it at startup.
+    static bool configure(const ZmqContextOptions& options);
+
+    // The shared context, created with the configured options on first use.
+    static std::shared_ptr<zmq::context_t> shared();
+
+    // A separate context with its own options, e.g. for a service that wants
+    // dedicated I/O threads for one hot socket.
+    static std::shared_ptr<zmq::context_t> create(const ZmqContextOptions& options);
+};